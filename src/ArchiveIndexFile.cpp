@@ -0,0 +1,140 @@
+#include "ArchiveIndexFile.h"
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <random>
+
+// Text file, one tab separated record per line. Paths and filenames are last on their line.
+//   A <modification time> <size> <entry count> <archive path>
+//   E <offset> <size> <compressed> <filename>
+const std::string ArchiveIndexFile::Header = "OP2MapImager Archive Index 1";
+
+ArchiveIndexFile::ArchiveIndexFile(const std::string& filename) : filename(filename), modified(false)
+{
+	Load();
+}
+
+bool ArchiveIndexFile::Find(const std::string& archivePath, int64_t modificationTime, uint64_t size, std::vector<ArchiveEntry>& archiveEntries) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto iterator = indexedArchives.find(archivePath);
+	if (iterator == indexedArchives.end() ||
+		iterator->second.modificationTime != modificationTime ||
+		iterator->second.size != size)
+	{
+		return false;
+	}
+
+	archiveEntries = iterator->second.archiveEntries;
+	return true;
+}
+
+void ArchiveIndexFile::Update(const std::string& archivePath, int64_t modificationTime, uint64_t size, const std::vector<ArchiveEntry>& archiveEntries)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	indexedArchives[archivePath] = IndexedArchive{ modificationTime, size, archiveEntries };
+	modified = true;
+}
+
+void ArchiveIndexFile::Save()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (!modified) {
+		return;
+	}
+
+	// Write to a uniquely named file first, so concurrent runs never read a partially written index
+	std::random_device randomDevice;
+	const std::string temporaryFilename = filename + "." + std::to_string(randomDevice()) + ".tmp";
+
+	{
+		std::ofstream file(temporaryFilename, std::ios::out | std::ios::trunc);
+		file << Header << '\n';
+
+		for (const auto& indexedArchive : indexedArchives)
+		{
+			const auto& archive = indexedArchive.second;
+			file << "A\t" << archive.modificationTime << '\t' << archive.size << '\t' <<
+				archive.archiveEntries.size() << '\t' << indexedArchive.first << '\n';
+
+			for (const auto& archiveEntry : archive.archiveEntries) {
+				file << "E\t" << archiveEntry.offset << '\t' << archiveEntry.size << '\t' <<
+					(archiveEntry.compressed ? 1 : 0) << '\t' << archiveEntry.filename << '\n';
+			}
+		}
+
+		file.close();
+
+		if (!file) {
+			std::error_code errorCode;
+			std::filesystem::remove(temporaryFilename, errorCode);
+			return;
+		}
+	}
+
+	std::error_code errorCode;
+	std::filesystem::rename(temporaryFilename, filename, errorCode);
+	if (errorCode) {
+		std::filesystem::remove(temporaryFilename, errorCode);
+		return;
+	}
+
+	modified = false;
+}
+
+void ArchiveIndexFile::Load()
+{
+	std::ifstream file(filename);
+	std::string line;
+
+	if (!file || !std::getline(file, line) || line != Header) {
+		return;
+	}
+
+	std::map<std::string, IndexedArchive> loadedArchives;
+
+	while (std::getline(file, line))
+	{
+		std::istringstream archiveRecord(line);
+		std::string recordType;
+		IndexedArchive archive;
+		std::size_t entryCount;
+		std::string archivePath;
+
+		if (!std::getline(archiveRecord, recordType, '\t') || recordType != "A" ||
+			!(archiveRecord >> archive.modificationTime >> archive.size >> entryCount) ||
+			archiveRecord.get() != '\t' || !std::getline(archiveRecord, archivePath))
+		{
+			// A damaged index is discarded and rebuilt
+			return;
+		}
+
+		for (std::size_t i = 0; i < entryCount; ++i)
+		{
+			ArchiveEntry archiveEntry;
+			int compressed;
+
+			if (!std::getline(file, line)) {
+				return;
+			}
+
+			std::istringstream entryRecord(line);
+			if (!std::getline(entryRecord, recordType, '\t') || recordType != "E" ||
+				!(entryRecord >> archiveEntry.offset >> archiveEntry.size >> compressed) ||
+				entryRecord.get() != '\t' || !std::getline(entryRecord, archiveEntry.filename))
+			{
+				return;
+			}
+
+			archiveEntry.compressed = compressed != 0;
+			archive.archiveEntries.push_back(archiveEntry);
+		}
+
+		loadedArchives[archivePath] = std::move(archive);
+	}
+
+	indexedArchives = std::move(loadedArchives);
+}
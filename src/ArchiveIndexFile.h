@@ -0,0 +1,43 @@
+#pragma once
+
+#include "VolIndexReader.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <cstdint>
+
+// Keeps the entry tables of archives in a file between runs, so archives need not be parsed on startup.
+// An archive's entries are reused while its size and modification time are unchanged.
+// Modification times are stored as read from the file system, so index files are only meant
+// for the machine that wrote them. Thread safe.
+class ArchiveIndexFile
+{
+public:
+	// Loads the index file if it exists. A missing or invalid index file starts an empty index.
+	explicit ArchiveIndexFile(const std::string& filename);
+
+	// Returns false if the archive is not indexed or changed since it was indexed
+	bool Find(const std::string& archivePath, int64_t modificationTime, uint64_t size, std::vector<ArchiveEntry>& archiveEntries) const;
+	void Update(const std::string& archivePath, int64_t modificationTime, uint64_t size, const std::vector<ArchiveEntry>& archiveEntries);
+
+	// Writes the index file if the index changed. Failures are ignored, since the index only speeds up later runs.
+	void Save();
+
+private:
+	struct IndexedArchive
+	{
+		int64_t modificationTime;
+		uint64_t size;
+		std::vector<ArchiveEntry> archiveEntries;
+	};
+
+	static const std::string Header;
+
+	const std::string filename;
+	std::map<std::string, IndexedArchive> indexedArchives;
+	bool modified;
+	mutable std::mutex mutex;
+
+	void Load();
+};
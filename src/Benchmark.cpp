@@ -0,0 +1,352 @@
+#include "Benchmark.h"
+#include "TileBlitter.h"
+#include "ImageFilter.h"
+#include "TilesetBmpDecoder.h"
+#include "PngWriter.h"
+#include "QoiWriter.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+void Benchmark::Run()
+{
+	cout << "OP2MapImager Benchmark (Instruction set: " << TileBlitter::InstructionSetName() << ")" << endl << endl;
+
+	RunTileCopyBenchmark();
+	RunScaleFilterBenchmark();
+	RunTilesetDecodeBenchmark();
+	RunPngEncodeBenchmark();
+	RunPngPresetBenchmark();
+}
+
+// Renders a synthetic 256x256 tile map at each scale factor with a fixed tile copy, once with the generic
+// tile copy and once with the fixed copy. Both use the same row copy instruction set.
+// SelectCopyTile only uses the fixed copies of scales whose speedup is clearly above noise.
+void Benchmark::RunTileCopyBenchmark()
+{
+	const unsigned mapTileLength = 256;
+	const unsigned tilesetTileCount = 64;
+	const unsigned bytesPerPixel = 3;
+	const unsigned scaleFactors[] = { 1, 2, 4, 8, 16, 32 };
+
+	cout << "+++ TILE COPY (" << mapTileLength << "x" << mapTileLength << " tile map, 24 bit) +++" << endl;
+	cout << setw(8) << "Scale" << setw(16) << "Generic (ms)" << setw(14) << "Fixed (ms)" << setw(12) << "Speedup" << endl;
+
+	for (const auto scaleFactor : scaleFactors)
+	{
+		const std::size_t sourcePitch = scaleFactor * bytesPerPixel;
+		const std::size_t destPitch = static_cast<std::size_t>(mapTileLength) * scaleFactor * bytesPerPixel;
+
+		vector<BYTE> tileset(sourcePitch * scaleFactor * tilesetTileCount);
+		for (std::size_t i = 0; i < tileset.size(); ++i) {
+			tileset[i] = static_cast<BYTE>(i);
+		}
+		vector<BYTE> render(destPitch * mapTileLength * scaleFactor);
+
+		// Repeat small scales so each measurement covers a comparable amount of work
+		const unsigned repetitions = 32 / scaleFactor;
+
+		auto renderMap = [&](TileBlitter::CopyTileFunction copyTile) {
+			Timer timer;
+			timer.StartTimer();
+
+			for (unsigned repetition = 0; repetition < repetitions; ++repetition) {
+				for (unsigned y = 0; y < mapTileLength; ++y) {
+					for (unsigned x = 0; x < mapTileLength; ++x) {
+						const unsigned tileIndex = (x * 7 + y * 13) % tilesetTileCount;
+						copyTile(&render[y * scaleFactor * destPitch + x * sourcePitch], destPitch,
+							&tileset[tileIndex * scaleFactor * sourcePitch], sourcePitch, scaleFactor, bytesPerPixel);
+					}
+				}
+			}
+
+			return timer.GetElapsedTime() * 1000 / repetitions;
+		};
+
+		// Warm up caches and page in the render before measuring
+		renderMap(TileBlitter::CopyTileGeneric);
+
+		const double genericTime = renderMap(TileBlitter::CopyTileGeneric);
+		const double fixedTime = renderMap(TileBlitter::SelectFixedCopyTile(scaleFactor, bytesPerPixel));
+
+		cout << fixed << setprecision(2) <<
+			setw(8) << scaleFactor <<
+			setw(16) << genericTime <<
+			setw(14) << fixedTime <<
+			setw(11) << genericTime / fixedTime << "x" << endl;
+	}
+
+	cout << endl;
+}
+
+// Scales a synthetic 512 tile, 24 bit tileset to each scale factor evenly dividing the tile size,
+// comparing FreeImage's box and default Catmull-Rom filters with the native box filter.
+void Benchmark::RunScaleFilterBenchmark()
+{
+	const unsigned tileLength = 32;
+	const unsigned tilesetTileCount = 512;
+	const unsigned scaleFactors[] = { 1, 2, 4, 8, 16 };
+	const unsigned repetitions = 4;
+
+	FreeImageBmp tileset(tileLength, tileLength * tilesetTileCount, 24);
+	for (unsigned y = 0; y < tileset.Height(); ++y) {
+		BYTE* pixel = tileset.ScanLine(y);
+		for (unsigned i = 0; i < tileset.Width() * 3; ++i) {
+			pixel[i] = static_cast<BYTE>(y * 31 + i * 7);
+		}
+	}
+
+	cout << "+++ TILESET SCALING (" << tilesetTileCount << " tiles, 24 bit) +++" << endl;
+	cout << setw(8) << "Scale" << setw(18) << "CatmullRom (ms)" << setw(12) << "Box (ms)" << setw(16) << "FastBox (ms)" << endl;
+
+	for (const auto scaleFactor : scaleFactors)
+	{
+		auto timeScaling = [&](auto scaleTileset) {
+			Timer timer;
+			timer.StartTimer();
+
+			for (unsigned repetition = 0; repetition < repetitions; ++repetition) {
+				scaleTileset();
+			}
+
+			return timer.GetElapsedTime() * 1000 / repetitions;
+		};
+
+		auto rescale = [&](FREE_IMAGE_FILTER filter) {
+			return timeScaling([&]() { tileset.Rescale(scaleFactor, scaleFactor * tilesetTileCount, filter); });
+		};
+
+		const double catmullRomTime = rescale(FILTER_CATMULLROM);
+		const double boxTime = rescale(FILTER_BOX);
+		const double fastBoxTime = timeScaling([&]() { ImageFilter::BoxDownsample(tileset, tileLength / scaleFactor); });
+
+		cout << fixed << setprecision(2) <<
+			setw(8) << scaleFactor <<
+			setw(18) << catmullRomTime <<
+			setw(12) << boxTime <<
+			setw(16) << fastBoxTime << endl;
+	}
+
+	cout << endl;
+}
+
+// Decodes a synthetic 8 bit tileset BMP into a 24 bit bitmap with FreeImage and with the native tileset decoder
+void Benchmark::RunTilesetDecodeBenchmark()
+{
+	const unsigned tileLength = 32;
+	const unsigned tilesetTileCount = 512;
+	const unsigned height = tileLength * tilesetTileCount;
+	const unsigned repetitions = 16;
+
+	const uint32_t paletteSize = 256 * 4;
+	const uint32_t pixelDataOffset = 14 + 40 + paletteSize;
+	const uint32_t fileSize = pixelDataOffset + tileLength * height;
+
+	vector<BYTE> tilesetFile(fileSize);
+	auto writeUint32 = [&](std::size_t offset, uint32_t value) {
+		for (unsigned i = 0; i < 4; ++i) {
+			tilesetFile[offset + i] = static_cast<BYTE>(value >> (i * 8));
+		}
+	};
+
+	tilesetFile[0] = 'B';
+	tilesetFile[1] = 'M';
+	writeUint32(2, fileSize);
+	writeUint32(10, pixelDataOffset);
+	writeUint32(14, 40);
+	writeUint32(18, tileLength);
+	writeUint32(22, height);
+	writeUint32(26, 1 | (8 << 16)); // Planes, bits per pixel
+	for (std::size_t i = 54; i < fileSize; ++i) {
+		tilesetFile[i] = static_cast<BYTE>(i * 7);
+	}
+
+	auto timeDecoding = [&](auto decodeTileset) {
+		Timer timer;
+		timer.StartTimer();
+
+		for (unsigned repetition = 0; repetition < repetitions; ++repetition) {
+			decodeTileset();
+		}
+
+		return timer.GetElapsedTime() * 1000 / repetitions;
+	};
+
+	auto decodeWithFreeImage = [&]() {
+		FIMEMORY* fiMemory = FreeImage_OpenMemory(tilesetFile.data(), static_cast<DWORD>(tilesetFile.size()));
+		FreeImage_GetFileTypeFromMemory(fiMemory, 0);
+		FreeImageBmp tilesetBmp = FreeImageBmp(FIF_BMP, fiMemory).ConvertToBpp(24);
+		FreeImage_CloseMemory(fiMemory);
+		return tilesetBmp;
+	};
+
+	// Both decoders must produce identical pixels for the comparison to be meaningful
+	const FreeImageBmp freeImageTileset = decodeWithFreeImage();
+	const auto nativeTileset = TilesetBmpDecoder::Decode(tilesetFile.data(), tilesetFile.size(), 24);
+	bool pixelsMatch = nativeTileset != nullptr;
+	for (unsigned y = 0; pixelsMatch && y < height; ++y) {
+		pixelsMatch = std::memcmp(freeImageTileset.ScanLine(y), nativeTileset->ScanLine(y), tileLength * 3) == 0;
+	}
+
+	const double freeImageTime = timeDecoding(decodeWithFreeImage);
+	const double nativeTime = timeDecoding([&]() { TilesetBmpDecoder::Decode(tilesetFile.data(), tilesetFile.size(), 24); });
+
+	cout << "+++ TILESET DECODING (" << tilesetTileCount << " tiles, 8 bit to 24 bit) +++" << endl;
+	cout << setw(16) << "FreeImage (ms)" << setw(13) << "Native (ms)" << setw(12) << "Speedup" << setw(17) << "Pixels match" << endl;
+	cout << fixed << setprecision(2) <<
+		setw(16) << freeImageTime <<
+		setw(13) << nativeTime <<
+		setw(11) << freeImageTime / nativeTime << "x" <<
+		setw(17) << (pixelsMatch ? "yes" : "no") << endl;
+
+	cout << endl;
+}
+
+// Renders a synthetic map of random tiles, with patches of a few repeated tiles as in open terrain
+vector<BYTE> Benchmark::CreateSyntheticRender(unsigned mapTileLength, unsigned tileLength)
+{
+	const unsigned tilesetTileCount = 64;
+	const unsigned bytesPerPixel = 3;
+	const std::size_t tilePitch = static_cast<std::size_t>(tileLength) * bytesPerPixel;
+	const std::size_t renderPitch = tilePitch * mapTileLength;
+
+	// Tiles shade smoothly with a little noise, like the weathered terrain of real tilesets
+	uint32_t noise = 1;
+	auto nextNoise = [&noise]() {
+		noise = noise * 1664525 + 1013904223;
+		return noise;
+	};
+
+	vector<BYTE> tileset(tilePitch * tileLength * tilesetTileCount);
+	for (std::size_t i = 0; i < tileset.size(); ++i) {
+		const std::size_t tileIndex = i / (tilePitch * tileLength);
+		const std::size_t pixelOffset = i % (tilePitch * tileLength);
+		tileset[i] = static_cast<BYTE>(tileIndex * 37 + (pixelOffset / tilePitch) * 3 +
+			(pixelOffset % tilePitch) / bytesPerPixel + (pixelOffset % bytesPerPixel) * 50 + (nextNoise() >> 29));
+	}
+
+	vector<BYTE> render(renderPitch * mapTileLength * tileLength);
+	for (unsigned y = 0; y < mapTileLength; ++y) {
+		for (unsigned x = 0; x < mapTileLength; ++x)
+		{
+			unsigned tileIndex = (nextNoise() >> 24) % tilesetTileCount;
+			if ((x / 8 + y / 8) % 3 == 0) {
+				tileIndex = (x + y) % 4;
+			}
+
+			for (unsigned row = 0; row < tileLength; ++row) {
+				const BYTE* source = &tileset[(tileIndex * tileLength + row) * tilePitch];
+				std::copy(source, source + tilePitch, &render[(y * tileLength + row) * renderPitch + x * tilePitch]);
+			}
+		}
+	}
+
+	return render;
+}
+
+string Benchmark::EncodePng(const vector<BYTE>& image, unsigned imageLength, PngPreset pngPreset, ThreadPool* threadPool, double& time)
+{
+	const std::size_t pitch = static_cast<std::size_t>(imageLength) * 3;
+	const auto compression = PngWriter::GetPresetCompression(pngPreset);
+
+	Timer timer;
+	timer.StartTimer();
+
+	std::ostringstream encodedImage(std::ios::out | std::ios::binary);
+	PngWriter pngWriter(encodedImage, imageLength, imageLength, 24, {},
+		compression.compressionLevel, compression.filter, compression.strategy, threadPool);
+	pngWriter.WriteScanlines(image.data(), static_cast<std::ptrdiff_t>(pitch), imageLength);
+	pngWriter.Finish();
+
+	time = timer.GetElapsedTime() * 1000;
+	return encodedImage.str();
+}
+
+// Compresses a synthetic 128x128 tile map rendered at scale 32 as PNG on one thread and on every hardware thread.
+// Chunking depends only on image width, so both encodings must be byte identical.
+void Benchmark::RunPngEncodeBenchmark()
+{
+	const unsigned mapTileLength = 128;
+	const unsigned tileLength = 32;
+	const unsigned imageLength = mapTileLength * tileLength;
+	const vector<BYTE> image = CreateSyntheticRender(mapTileLength, tileLength);
+
+	ThreadPool threadPool(0);
+
+	double singleThreadTime;
+	double multiThreadTime;
+	const string singleThreadImage = EncodePng(image, imageLength, PngPreset::Balanced, nullptr, singleThreadTime);
+	const string multiThreadImage = EncodePng(image, imageLength, PngPreset::Balanced, &threadPool, multiThreadTime);
+
+	cout << "+++ PNG ENCODING (" << imageLength << "x" << imageLength << ", 24 bit, " << threadPool.ThreadCount() << " threads) +++" << endl;
+	cout << setw(16) << "1 thread (ms)" << setw(18) << "All threads (ms)" << setw(12) << "Speedup" << setw(12) << "Size (KB)" <<
+		setw(17) << "Output match" << endl;
+	cout << fixed << setprecision(2) <<
+		setw(16) << singleThreadTime <<
+		setw(18) << multiThreadTime <<
+		setw(11) << singleThreadTime / multiThreadTime << "x" <<
+		setw(12) << singleThreadImage.size() / 1024 <<
+		setw(17) << (singleThreadImage == multiThreadImage ? "yes" : "no") << endl;
+
+	cout << endl;
+}
+
+// Compresses synthetic tile map renders at several scales with each PNG preset on every hardware thread, and with QOI
+void Benchmark::RunPngPresetBenchmark()
+{
+	const unsigned mapTileLength = 128;
+	const unsigned scaleFactors[] = { 8, 32 };
+	const PngPreset pngPresets[] = { PngPreset::Fast, PngPreset::Balanced, PngPreset::Small };
+	const char* const pngPresetNames[] = { "Fast", "Balanced", "Small" };
+
+	ThreadPool threadPool(0);
+
+	cout << "+++ PNG PRESETS (" << mapTileLength << "x" << mapTileLength << " tile map, 24 bit) +++" << endl;
+	cout << setw(8) << "Scale" << setw(12) << "Preset" << setw(16) << "Encode (ms)" << setw(12) << "Size (KB)" << setw(14) << "Raw ratio" << endl;
+
+	for (const auto scaleFactor : scaleFactors)
+	{
+		const unsigned imageLength = mapTileLength * scaleFactor;
+		const vector<BYTE> image = CreateSyntheticRender(mapTileLength, scaleFactor);
+
+		for (std::size_t i = 0; i < sizeof(pngPresets) / sizeof(pngPresets[0]); ++i)
+		{
+			double time;
+			const string encodedImage = EncodePng(image, imageLength, pngPresets[i], &threadPool, time);
+
+			cout << fixed << setprecision(2) <<
+				setw(8) << scaleFactor <<
+				setw(12) << pngPresetNames[i] <<
+				setw(16) << time <<
+				setw(12) << encodedImage.size() / 1024 <<
+				setw(13) << 100.0 * encodedImage.size() / image.size() << "%" << endl;
+		}
+
+		// QOI for comparison, as the fastest lossless format
+		Timer timer;
+		timer.StartTimer();
+		std::ostringstream qoiImage(std::ios::out | std::ios::binary);
+		QoiWriter qoiWriter(qoiImage, imageLength, imageLength, 24);
+		qoiWriter.WriteScanlines(image.data(), static_cast<std::ptrdiff_t>(imageLength) * 3, imageLength);
+		qoiWriter.Finish();
+		const double qoiTime = timer.GetElapsedTime() * 1000;
+
+		cout << fixed << setprecision(2) <<
+			setw(8) << scaleFactor <<
+			setw(12) << "QOI" <<
+			setw(16) << qoiTime <<
+			setw(12) << qoiImage.str().size() / 1024 <<
+			setw(13) << 100.0 * qoiImage.str().size() / image.size() << "%" << endl;
+	}
+
+	cout << endl;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "PngWriter.h"
+#include "ThreadPool.h"
+#include <string>
+#include <vector>
+
+// Measures render performance on synthetic data. Run with the --Benchmark switch or `make bench`.
+class Benchmark
+{
+public:
+	static void Run();
+
+private:
+	static void RunTileCopyBenchmark();
+	static void RunScaleFilterBenchmark();
+	static void RunTilesetDecodeBenchmark();
+	static void RunPngEncodeBenchmark();
+	static void RunPngPresetBenchmark();
+
+	// Returns 24 bit scanlines of a square tile map render, in top-down order
+	static std::vector<BYTE> CreateSyntheticRender(unsigned mapTileLength, unsigned tileLength);
+	static std::string EncodePng(const std::vector<BYTE>& image, unsigned imageLength, PngPreset pngPreset, ThreadPool* threadPool, double& time);
+};
@@ -0,0 +1,118 @@
+#include "BmpWriter.h"
+#include <stdexcept>
+#include <limits>
+
+BmpWriter::BmpWriter(const std::string& filename, unsigned width, unsigned height, unsigned bpp, const std::vector<RGBQUAD>& palette) :
+	filename(filename),
+	width(width),
+	height(height),
+	bytesPerPixel(bpp / 8),
+	rowSize((static_cast<std::size_t>(width) * bytesPerPixel + 3) & ~static_cast<std::size_t>(3)),
+	scanlinesWritten(0),
+	file(filename, std::ios::out | std::ios::binary | std::ios::trunc)
+{
+	if (bpp != 8 && bpp != 24 && bpp != 32) {
+		throw std::runtime_error("BMP writer only supports 8, 24 and 32 bits per pixel");
+	}
+	if (bpp == 8 && (palette.empty() || palette.size() > 256)) {
+		throw std::runtime_error("An 8 bit BMP file requires a palette of 1 to 256 colors");
+	}
+
+	CheckFileState();
+	WriteHeader(bpp, bpp == 8 ? palette : std::vector<RGBQUAD>());
+}
+
+void BmpWriter::WriteHeader(unsigned bpp, const std::vector<RGBQUAD>& palette)
+{
+	const uint32_t headerSize = static_cast<uint32_t>(14 + 40 + palette.size() * sizeof(RGBQUAD));
+	const uint64_t imageSize = static_cast<uint64_t>(rowSize) * height;
+
+	const unsigned maxHeight = static_cast<unsigned>(std::numeric_limits<int32_t>::max());
+	if (imageSize + headerSize > std::numeric_limits<uint32_t>::max() || height > maxHeight) {
+		throw std::runtime_error("Render is too large to save as a BMP file: " + filename);
+	}
+
+	std::vector<BYTE> header;
+
+	// BITMAPFILEHEADER
+	header.push_back('B');
+	header.push_back('M');
+	AppendUint32(header, static_cast<uint32_t>(headerSize + imageSize));
+	AppendUint32(header, 0); // Reserved
+	AppendUint32(header, headerSize);
+
+	// BITMAPINFOHEADER. A negative height marks the scanlines as stored top-down.
+	AppendUint32(header, 40);
+	AppendUint32(header, width);
+	AppendUint32(header, static_cast<uint32_t>(-static_cast<int32_t>(height)));
+	AppendUint16(header, 1); // Planes
+	AppendUint16(header, static_cast<uint16_t>(bpp));
+	AppendUint32(header, 0); // BI_RGB, uncompressed
+	AppendUint32(header, static_cast<uint32_t>(imageSize));
+	AppendUint32(header, 2835); // Horizontal resolution, 72 DPI
+	AppendUint32(header, 2835); // Vertical resolution, 72 DPI
+	AppendUint32(header, static_cast<uint32_t>(palette.size())); // Colors used
+	AppendUint32(header, 0); // Important colors
+
+	// Palette entries are stored blue, green, red, reserved
+	for (const auto& color : palette) {
+		header.push_back(color.rgbBlue);
+		header.push_back(color.rgbGreen);
+		header.push_back(color.rgbRed);
+		header.push_back(0);
+	}
+
+	file.write(reinterpret_cast<const char*>(header.data()), header.size());
+	CheckFileState();
+}
+
+void BmpWriter::WriteScanlines(const BYTE* topScanline, std::ptrdiff_t pitch, unsigned scanlineCount)
+{
+	if (scanlineCount > height - scanlinesWritten) {
+		throw std::runtime_error("More scanlines written than the height of " + filename);
+	}
+
+	// BMP shares FreeImage's byte order, so rows only need padding
+	const std::size_t pixelByteCount = static_cast<std::size_t>(width) * bytesPerPixel;
+	const char padding[3] = { 0, 0, 0 };
+
+	const BYTE* scanline = topScanline;
+	for (unsigned i = 0; i < scanlineCount; ++i)
+	{
+		file.write(reinterpret_cast<const char*>(scanline), pixelByteCount);
+		file.write(padding, rowSize - pixelByteCount);
+		scanline += pitch;
+	}
+
+	CheckFileState();
+	scanlinesWritten += scanlineCount;
+}
+
+void BmpWriter::Finish()
+{
+	if (scanlinesWritten != height) {
+		throw std::runtime_error("Render was not completely written to " + filename);
+	}
+
+	file.close();
+	CheckFileState();
+}
+
+void BmpWriter::AppendUint16(std::vector<BYTE>& buffer, uint16_t value)
+{
+	buffer.push_back(static_cast<BYTE>(value));
+	buffer.push_back(static_cast<BYTE>(value >> 8));
+}
+
+void BmpWriter::AppendUint32(std::vector<BYTE>& buffer, uint32_t value)
+{
+	AppendUint16(buffer, static_cast<uint16_t>(value));
+	AppendUint16(buffer, static_cast<uint16_t>(value >> 16));
+}
+
+void BmpWriter::CheckFileState()
+{
+	if (!file) {
+		throw std::runtime_error("Error writing render to file: " + filename);
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "ScanlineWriter.h"
+#include <string>
+#include <fstream>
+#include <vector>
+#include <cstdint>
+
+// Streams an uncompressed 8 bit indexed, 24 or 32 bit top-down BMP file
+class BmpWriter : public ScanlineWriter
+{
+public:
+	// An 8 bit file requires a palette of up to 256 colors
+	BmpWriter(const std::string& filename, unsigned width, unsigned height, unsigned bpp,
+		const std::vector<RGBQUAD>& palette = {});
+
+	void WriteScanlines(const BYTE* topScanline, std::ptrdiff_t pitch, unsigned scanlineCount) override;
+	void Finish() override;
+
+private:
+	const std::string filename;
+	const unsigned width;
+	const unsigned height;
+	const unsigned bytesPerPixel;
+	const std::size_t rowSize; // Scanlines are padded to a multiple of 4 bytes
+	unsigned scanlinesWritten;
+	std::ofstream file;
+
+	void WriteHeader(unsigned bpp, const std::vector<RGBQUAD>& palette);
+	void CheckFileState();
+
+	// BMP fields are little endian
+	static void AppendUint16(std::vector<BYTE>& buffer, uint16_t value);
+	static void AppendUint32(std::vector<BYTE>& buffer, uint32_t value);
+};
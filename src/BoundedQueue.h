@@ -0,0 +1,62 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <utility>
+#include <cstddef>
+
+// Blocking first in, first out queue holding at most capacity items.
+// Producers wait while the queue is full, limiting how far they may run ahead of consumers.
+template<typename T>
+class BoundedQueue
+{
+public:
+	explicit BoundedQueue(std::size_t capacity) : capacity(capacity == 0 ? 1 : capacity), closed(false) { }
+
+	BoundedQueue(const BoundedQueue&) = delete;
+	BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+	// Blocks while the queue is full
+	void Push(T item)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		notFull.wait(lock, [this] { return items.size() < capacity; });
+
+		items.push_back(std::move(item));
+		notEmpty.notify_one();
+	}
+
+	// Blocks until an item is available. Returns false once the queue is closed and empty.
+	bool Pop(T& item)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		notEmpty.wait(lock, [this] { return !items.empty() || closed; });
+
+		if (items.empty()) {
+			return false;
+		}
+
+		item = std::move(items.front());
+		items.pop_front();
+		notFull.notify_one();
+
+		return true;
+	}
+
+	// Called by the producer once no more items will be pushed
+	void Close()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+		notEmpty.notify_all();
+	}
+
+private:
+	const std::size_t capacity;
+	std::deque<T> items;
+	bool closed;
+	std::mutex mutex;
+	std::condition_variable notFull;
+	std::condition_variable notEmpty;
+};
@@ -1,6 +1,8 @@
 #include "ConsoleArgumentParser.h"
 #include "OP2Utility.h"
 #include <stdexcept>
+#include <sstream>
+#include <cstdint>
 
 using namespace std;
 
@@ -14,6 +16,20 @@ ConsoleArgumentParser::ConsoleArgumentParser()
 	consoleSwitches.push_back(ConsoleSwitch("-Q", "--QUIET", ParseQuiet, 0));
 	consoleSwitches.push_back(ConsoleSwitch("-O", "--OVERWRITE", ParseOverwrite, 0));
 	consoleSwitches.push_back(ConsoleSwitch("-A", "--ACCESSARCHIVES", ParseAccessArchives, 0));
+	consoleSwitches.push_back(ConsoleSwitch("-B", "--BENCHMARK", ParseBenchmark, 0));
+	consoleSwitches.push_back(ConsoleSwitch("-T", "--THREADS", ParseThreads, 1));
+	consoleSwitches.push_back(ConsoleSwitch("-R", "--STREAMROWS", ParseStreamRows, 1));
+	consoleSwitches.push_back(ConsoleSwitch("-C", "--TILESETCACHE", ParseTilesetCache, 1));
+	consoleSwitches.push_back(ConsoleSwitch("-F", "--FILTER", ParseScaleFilter, 1));
+	consoleSwitches.push_back(ConsoleSwitch("-J", "--JOBS", ParseJobs, 1));
+	consoleSwitches.push_back(ConsoleSwitch("-P", "--PIPELINE", ParsePipeline, 1));
+	consoleSwitches.push_back(ConsoleSwitch("-M", "--MAXMEMORY", ParseMaxMemory, 1));
+	consoleSwitches.push_back(ConsoleSwitch("-X", "--ARCHIVEINDEX", ParseArchiveIndex, 1));
+	consoleSwitches.push_back(ConsoleSwitch("-N", "--INDEXED", ParseIndexed, 0));
+	consoleSwitches.push_back(ConsoleSwitch("-U", "--INCREMENTAL", ParseIncremental, 0));
+	consoleSwitches.push_back(ConsoleSwitch("-Z", "--PNGPRESET", ParsePngPreset, 1));
+	consoleSwitches.push_back(ConsoleSwitch("-Y", "--TILEPYRAMID", ParseTilePyramid, 1));
+	consoleSwitches.push_back(ConsoleSwitch("-L", "--LINKDUPLICATETILES", ParseLinkDuplicateTiles, 0));
 };
 
 bool ConsoleArgumentParser::FindSwitch(char* argumentChar, ConsoleSwitch& currentSwitch)
@@ -84,8 +100,60 @@ ImageFormat ConsoleArgumentParser::ParseImageTypeToEnum(const std::string& image
 	if (imageTypeStringUpper == "BMP" || imageTypeStringUpper == "BITMAP") {
 		return ImageFormat::BMP;
 	}
+	if (imageTypeStringUpper == "QOI") {
+		return ImageFormat::QOI;
+	}
+	if (imageTypeStringUpper == "PPM") {
+		return ImageFormat::PPM;
+	}
+	if (imageTypeStringUpper == "PAM") {
+		return ImageFormat::PAM;
+	}
+
+	throw runtime_error("Unable to determine final render file type. Try PNG, JPG, BMP, QOI, PPM, or PAM.");
+}
+
+ScaleFilter ConsoleArgumentParser::ParseScaleFilterToEnum(const std::string& scaleFilterString)
+{
+	string scaleFilterStringUpper = StringHelper::ConvertToUpper(scaleFilterString);
+
+	if (scaleFilterStringUpper == "BOX") {
+		return ScaleFilter::Box;
+	}
+	if (scaleFilterStringUpper == "BILINEAR") {
+		return ScaleFilter::Bilinear;
+	}
+	if (scaleFilterStringUpper == "BICUBIC") {
+		return ScaleFilter::Bicubic;
+	}
+	if (scaleFilterStringUpper == "CATMULLROM") {
+		return ScaleFilter::CatmullRom;
+	}
+	if (scaleFilterStringUpper == "LANCZOS") {
+		return ScaleFilter::Lanczos;
+	}
+	if (scaleFilterStringUpper == "FASTBOX") {
+		return ScaleFilter::FastBox;
+	}
+
+	throw runtime_error("Unable to determine scale filter. Try Box, Bilinear, Bicubic, CatmullRom, Lanczos, or FastBox.");
+}
+
+PngPreset ConsoleArgumentParser::ParsePngPresetToEnum(const std::string& pngPresetString)
+{
+	string pngPresetStringUpper = StringHelper::ConvertToUpper(pngPresetString);
 
-	throw runtime_error("Unable to determine final render file type. Try PNG, JPG, or BMP.");
+	if (pngPresetStringUpper == "FAST") {
+		return PngPreset::Fast;
+	}
+	if (pngPresetStringUpper == "BALANCED") {
+		return PngPreset::Balanced;
+	}
+	if (pngPresetStringUpper == "SMALL") {
+		return PngPreset::Small;
+	}
+
+	throw runtime_error("Unable to determine PNG preset. Try Fast, Balanced, or Small.");
 }
 
 bool ConsoleArgumentParser::ParseBool(const string& str)
@@ -119,6 +187,11 @@ void ConsoleArgumentParser::ParseHelp(const char* value, ConsoleArgs& consoleArg
 	consoleArgs.renderSettings.helpRequested = true;
 }
 
+void ConsoleArgumentParser::ParseBenchmark(const char* value, ConsoleArgs& consoleArgs)
+{
+	consoleArgs.renderSettings.benchmarkRequested = true;
+}
+
 void ConsoleArgumentParser::ParseQuiet(const char* value, ConsoleArgs& consoleArgs)
 {
 	consoleArgs.renderSettings.quiet = true;
@@ -129,21 +202,123 @@ void ConsoleArgumentParser::ParseOverwrite(const char* value, ConsoleArgs& conso
 	consoleArgs.renderSettings.overwrite = true;
 }
 
+void ConsoleArgumentParser::ParseIndexed(const char* value, ConsoleArgs& consoleArgs)
+{
+	consoleArgs.renderSettings.indexed = true;
+}
+
+void ConsoleArgumentParser::ParseLinkDuplicateTiles(const char* value, ConsoleArgs& consoleArgs)
+{
+	consoleArgs.renderSettings.linkDuplicateTiles = true;
+}
+
+void ConsoleArgumentParser::ParseIncremental(const char* value, ConsoleArgs& consoleArgs)
+{
+	consoleArgs.renderSettings.incremental = true;
+}
+
 void ConsoleArgumentParser::ParseAccessArchives(const char* value, ConsoleArgs& consoleArgs)
 {
 	consoleArgs.renderSettings.accessArchives = false;
 }
 
+// Accepts a single scale factor or a comma separated list
 void ConsoleArgumentParser::ParseScale(const char* value, ConsoleArgs& consoleArgs)
 {
-	// stoi will throw an exception if it is unable to parse the string into an integer
-	int scaleFactor = stoi(value);
+	vector<unsigned> scaleFactors;
 
-	if (scaleFactor <= 0) {
+	stringstream scaleFactorList(value);
+	string scaleFactorString;
+	while (getline(scaleFactorList, scaleFactorString, ','))
+	{
+		// stoi will throw an exception if it is unable to parse the string into an integer
+		int scaleFactor = stoi(scaleFactorString);
+
+		if (scaleFactor <= 0) {
+			throw runtime_error("Scale Factor was set improperly.");
+		}
+
+		scaleFactors.push_back(scaleFactor);
+	}
+
+	if (scaleFactors.empty()) {
 		throw runtime_error("Scale Factor was set improperly.");
 	}
 
-	consoleArgs.renderSettings.scaleFactor = scaleFactor;
+	consoleArgs.renderSettings.scaleFactors = scaleFactors;
+}
+
+void ConsoleArgumentParser::ParseThreads(const char* value, ConsoleArgs& consoleArgs)
+{
+	// stoi will throw an exception if it is unable to parse the string into an integer
+	int threadCount = stoi(value);
+
+	if (threadCount < 0) {
+		throw runtime_error("Thread count was set improperly.");
+	}
+
+	consoleArgs.renderSettings.threadCount = threadCount;
+}
+
+void ConsoleArgumentParser::ParseJobs(const char* value, ConsoleArgs& consoleArgs)
+{
+	// stoi will throw an exception if it is unable to parse the string into an integer
+	int jobCount = stoi(value);
+
+	if (jobCount < 0) {
+		throw runtime_error("Job count was set improperly.");
+	}
+
+	consoleArgs.renderSettings.jobCount = jobCount;
+}
+
+void ConsoleArgumentParser::ParsePipeline(const char* value, ConsoleArgs& consoleArgs)
+{
+	// stoi will throw an exception if it is unable to parse the string into an integer
+	int pipelineDepth = stoi(value);
+
+	if (pipelineDepth < 0) {
+		throw runtime_error("Pipeline depth was set improperly.");
+	}
+
+	consoleArgs.renderSettings.pipelineDepth = pipelineDepth;
+}
+
+void ConsoleArgumentParser::ParseMaxMemory(const char* value, ConsoleArgs& consoleArgs)
+{
+	// stoll will throw an exception if it is unable to parse the string into an integer
+	long long megabytes = stoll(value);
+
+	if (megabytes < 0 || static_cast<unsigned long long>(megabytes) > UINT64_MAX / (1024 * 1024)) {
+		throw runtime_error("Maximum memory was set improperly.");
+	}
+
+	consoleArgs.renderSettings.maxMemory = static_cast<uint64_t>(megabytes) * 1024 * 1024;
+}
+
+void ConsoleArgumentParser::ParseStreamRows(const char* value, ConsoleArgs& consoleArgs)
+{
+	// stoi will throw an exception if it is unable to parse the string into an integer
+	int streamTileRows = stoi(value);
+
+	if (streamTileRows < 0) {
+		throw runtime_error("Stream row count was set improperly.");
+	}
+
+	consoleArgs.renderSettings.streamTileRows = streamTileRows;
+}
+
+void ConsoleArgumentParser::ParseTilePyramid(const char* value, ConsoleArgs& consoleArgs)
+{
+	// stoi will throw an exception if it is unable to parse the string into an integer
+	int pyramidTileSize = stoi(value);
+
+	// Pyramid tiles must cover whole map tiles at every scale, from 1 to 32 pixels per map tile
+	if (pyramidTileSize != 0 && (pyramidTileSize < 32 || pyramidTileSize > 8192 || (pyramidTileSize & (pyramidTileSize - 1)) != 0)) {
+		throw runtime_error("Tile pyramid size must be 0 or a power of 2 from 32 to 8192.");
+	}
+
+	consoleArgs.renderSettings.pyramidTileSize = pyramidTileSize;
 }
 
 void ConsoleArgumentParser::ParseDestDirectory(const char* value, ConsoleArgs& consoleArgs)
@@ -151,6 +326,26 @@ void ConsoleArgumentParser::ParseDestDirectory(const char* value, ConsoleArgs& c
 	consoleArgs.renderSettings.destDirectory = value;
 }
 
+void ConsoleArgumentParser::ParseTilesetCache(const char* value, ConsoleArgs& consoleArgs)
+{
+	consoleArgs.renderSettings.tilesetCacheDirectory = value;
+}
+
+void ConsoleArgumentParser::ParseArchiveIndex(const char* value, ConsoleArgs& consoleArgs)
+{
+	consoleArgs.renderSettings.archiveIndexFilename = value;
+}
+
+void ConsoleArgumentParser::ParseScaleFilter(const char* value, ConsoleArgs& consoleArgs)
+{
+	consoleArgs.renderSettings.scaleFilter = ParseScaleFilterToEnum(value);
+}
+
+void ConsoleArgumentParser::ParsePngPreset(const char* value, ConsoleArgs& consoleArgs)
+{
+	consoleArgs.renderSettings.pngPreset = ParsePngPresetToEnum(value);
+}
+
 void ConsoleArgumentParser::ParseImageFormat(const char* value, ConsoleArgs& consoleArgs)
 {
 	consoleArgs.renderSettings.imageFormat = ParseImageTypeToEnum(value);
@@ -46,14 +46,30 @@ private:
 	static bool ParseBool(const std::string& str);
 
 	static ImageFormat ParseImageTypeToEnum(const std::string& imageTypeString);
+	static ScaleFilter ParseScaleFilterToEnum(const std::string& scaleFilterString);
+	static PngPreset ParsePngPresetToEnum(const std::string& pngPresetString);
 	
 	static bool IsTooFewArguments(int argumentCount);
 
 	static void ParseQuiet(const char* value, ConsoleArgs& consoleArgs);
+	static void ParseIndexed(const char* value, ConsoleArgs& consoleArgs);
+	static void ParseLinkDuplicateTiles(const char* value, ConsoleArgs& consoleArgs);
+	static void ParseIncremental(const char* value, ConsoleArgs& consoleArgs);
 	static void ParseScale(const char* value, ConsoleArgs& consoleArgs);
+	static void ParseThreads(const char* value, ConsoleArgs& consoleArgs);
+	static void ParseJobs(const char* value, ConsoleArgs& consoleArgs);
+	static void ParsePipeline(const char* value, ConsoleArgs& consoleArgs);
+	static void ParseMaxMemory(const char* value, ConsoleArgs& consoleArgs);
+	static void ParseStreamRows(const char* value, ConsoleArgs& consoleArgs);
+	static void ParseTilePyramid(const char* value, ConsoleArgs& consoleArgs);
 	static void ParseImageFormat(const char* value, ConsoleArgs& consoleArgs);
 	static void ParseDestDirectory(const char* value, ConsoleArgs& consoleArgs);
+	static void ParseTilesetCache(const char* value, ConsoleArgs& consoleArgs);
+	static void ParseArchiveIndex(const char* value, ConsoleArgs& consoleArgs);
+	static void ParseScaleFilter(const char* value, ConsoleArgs& consoleArgs);
+	static void ParsePngPreset(const char* value, ConsoleArgs& consoleArgs);
 	static void ParseHelp(const char* value, ConsoleArgs& consoleArgs);
+	static void ParseBenchmark(const char* value, ConsoleArgs& consoleArgs);
 	static void ParseOverwrite(const char* value, ConsoleArgs& consoleArgs);
 	static void ParseAccessArchives(const char* value, ConsoleArgs& consoleArgs);
 };
@@ -0,0 +1,30 @@
+#include "ContentHash.h"
+
+uint64_t ContentHash::Compute(const void* data, std::size_t size, uint64_t seed)
+{
+	const uint64_t prime = 1099511628211ull;
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+	uint64_t hash = seed;
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= prime;
+	}
+
+	return hash;
+}
+
+std::string ContentHash::ToHex(uint64_t hash)
+{
+	const char hexDigits[] = "0123456789abcdef";
+
+	std::string hex(16, '0');
+	for (std::size_t i = hex.size(); i-- > 0; )
+	{
+		hex[i] = hexDigits[hash & 0xF];
+		hash >>= 4;
+	}
+
+	return hex;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// 64 bit FNV-1a hash identifying file contents in caches. Not suitable for security purposes.
+class ContentHash
+{
+public:
+	static constexpr uint64_t OffsetBasis = 14695981039346656037ull;
+
+	// Pass a previous result as the seed to continue hashing across several buffers
+	static uint64_t Compute(const void* data, std::size_t size, uint64_t seed = OffsetBasis);
+
+	// 16 lowercase hexadecimal digits
+	static std::string ToHex(uint64_t hash);
+};
@@ -14,6 +14,17 @@ FreeImageBmp::FreeImageBmp(FreeImageBmp&& other) : fiBitmap(other.fiBitmap)
 	other.fiBitmap = nullptr;
 }
 
+FreeImageBmp& FreeImageBmp::operator=(FreeImageBmp&& other)
+{
+	if (this != &other) {
+		FreeImage_Unload(fiBitmap);
+		fiBitmap = other.fiBitmap;
+		other.fiBitmap = nullptr;
+	}
+
+	return *this;
+}
+
 FreeImageBmp::FreeImageBmp(int width, int height, unsigned bpp) : 
 	fiBitmap(nullptr)
 {
@@ -60,10 +71,53 @@ unsigned FreeImageBmp::Height() const
 	return FreeImage_GetHeight(fiBitmap);
 }
 
-FreeImageBmp FreeImageBmp::Rescale(int scaledWidth, int scaledHeight) const
+unsigned FreeImageBmp::Bpp() const
+{
+	return FreeImage_GetBPP(fiBitmap);
+}
+
+unsigned FreeImageBmp::Pitch() const
+{
+	return FreeImage_GetPitch(fiBitmap);
+}
+
+BYTE* FreeImageBmp::ScanLine(unsigned y) const
+{
+	return FreeImage_GetScanLine(fiBitmap, y);
+}
+
+RGBQUAD* FreeImageBmp::Palette() const
+{
+	return FreeImage_GetPalette(fiBitmap);
+}
+
+FreeImageBmp FreeImageBmp::ConvertToBpp(unsigned bpp) const
+{
+	switch (bpp)
+	{
+	case 24:
+		return FreeImageBmp(FreeImage_ConvertTo24Bits(fiBitmap));
+	case 32:
+		return FreeImageBmp(FreeImage_ConvertTo32Bits(fiBitmap));
+	default:
+		throw std::runtime_error("Conversion to a bitmap with " + std::to_string(bpp) + " bits per pixel is not supported");
+	}
+}
+
+FreeImageBmp FreeImageBmp::ColorQuantize(FREE_IMAGE_QUANTIZE quantizeAlgorithm) const
+{
+	FIBITMAP* quantizedBitmap = FreeImage_ColorQuantizeEx(fiBitmap, quantizeAlgorithm, 256, 0, nullptr);
+	if (quantizedBitmap == nullptr) {
+		throw std::runtime_error("Unable to reduce the colors of a bitmap to a 256 color palette");
+	}
+
+	return FreeImageBmp(quantizedBitmap);
+}
+
+FreeImageBmp FreeImageBmp::Rescale(int scaledWidth, int scaledHeight, FREE_IMAGE_FILTER filter) const
 {
 	try {
-		return FreeImageBmp(FreeImage_Rescale(fiBitmap, scaledWidth, scaledHeight));
+		return FreeImageBmp(FreeImage_Rescale(fiBitmap, scaledWidth, scaledHeight, filter));
 	} catch(...) {
 		// Upgrade exception to more detailed error message
 		throw std::runtime_error(
@@ -92,3 +146,22 @@ void FreeImageBmp::Save(const std::string& filename, FREE_IMAGE_FORMAT fiImageFo
 		);
 	}
 }
+
+std::vector<BYTE> FreeImageBmp::SaveToMemory(FREE_IMAGE_FORMAT fiImageFormat, int flags) const
+{
+	FIMEMORY* fiMemory = FreeImage_OpenMemory();
+
+	if (!FreeImage_SaveToMemory(fiImageFormat, fiBitmap, fiMemory, flags)) {
+		FreeImage_CloseMemory(fiMemory);
+		throw std::runtime_error("Error encoding FreeImage bitmap to memory");
+	}
+
+	BYTE* data = nullptr;
+	DWORD size = 0;
+	FreeImage_AcquireMemory(fiMemory, &data, &size);
+
+	std::vector<BYTE> encodedImage(data, data + size);
+	FreeImage_CloseMemory(fiMemory);
+
+	return encodedImage;
+}
@@ -2,6 +2,7 @@
 
 #include "../FreeImage/Dist/x32/FreeImage.h"
 #include <string>
+#include <vector>
 
 // Wrapper for FIBITMAP to ensure proper destruction
 class FreeImageBmp
@@ -11,6 +12,7 @@ public:
 	FreeImageBmp(FIBITMAP* fiBitmap);
 
 	FreeImageBmp(FreeImageBmp&& other); // Move constructor
+	FreeImageBmp& operator=(FreeImageBmp&& other); // Move assignment
 
 	// Create a new, default bitmap (pixels are all black)
 	FreeImageBmp(int width, int height, unsigned bpp);
@@ -27,8 +29,25 @@ public:
 	unsigned Width() const;
 	unsigned Height() const;
 
+	// Get pixel layout. Pitch is the number of bytes between scanlines.
+	unsigned Bpp() const;
+	unsigned Pitch() const;
+
+	// Get raw pixel memory of a scanline. FreeImage stores scanlines bottom-up,
+	// so scanline 0 is the bottom row of the image.
+	BYTE* ScanLine(unsigned y) const;
+
+	// Palette of 256 entries for an 8 bit bitmap, nullptr for bitmaps without a palette
+	RGBQUAD* Palette() const;
+
+	// Create a copy of the bitmap converted to the requested bits per pixel
+	FreeImageBmp ConvertToBpp(unsigned bpp) const;
+
+	// Create an 8 bit copy of a 24 bit bitmap, reducing its colors to a palette of 256 colors
+	FreeImageBmp ColorQuantize(FREE_IMAGE_QUANTIZE quantizeAlgorithm) const;
+
 	// Create a rescaled bitmap
-	FreeImageBmp Rescale(int scaledWidth, int scaledHeight) const;
+	FreeImageBmp Rescale(int scaledWidth, int scaledHeight, FREE_IMAGE_FILTER filter = FILTER_CATMULLROM) const;
 
 	// Create view into bitmap
 	FreeImageBmp CreateView(unsigned left, unsigned top, unsigned right, unsigned bottom) const;
@@ -39,6 +58,9 @@ public:
 	// Save bitmap to file
 	void Save(const std::string& filename, FREE_IMAGE_FORMAT fiImageFormat, int flags) const;
 
+	// Encode bitmap into memory in the given file format
+	std::vector<BYTE> SaveToMemory(FREE_IMAGE_FORMAT fiImageFormat, int flags) const;
+
 private:
 	FIBITMAP* fiBitmap;
 };
@@ -0,0 +1,83 @@
+#include "ImageFilter.h"
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+using namespace std;
+
+FreeImageBmp ImageFilter::BoxDownsample(const FreeImageBmp& source, unsigned factor)
+{
+	const unsigned bpp = source.Bpp();
+	if (bpp != 24 && bpp != 32) {
+		throw runtime_error("Box filtering requires a 24 or 32 bit image.");
+	}
+	if (factor == 0 || source.Width() % factor != 0 || source.Height() % factor != 0) {
+		throw runtime_error("Image dimensions must be a multiple of the box filter size.");
+	}
+
+	FreeImageBmp dest(source.Width() / factor, source.Height() / factor, bpp);
+
+	if (bpp == 24) {
+		BoxDownsampleRows<3>(source, dest, factor);
+	}
+	else {
+		BoxDownsampleRows<4>(source, dest, factor);
+	}
+
+	return dest;
+}
+
+// Source scanlines are read once, front to back, so the filter is limited by memory bandwidth
+template<unsigned BytesPerPixel>
+void ImageFilter::BoxDownsampleRows(const FreeImageBmp& source, FreeImageBmp& dest, unsigned factor)
+{
+	const unsigned width = dest.Width();
+	const unsigned height = dest.Height();
+	const unsigned rowByteCount = width * BytesPerPixel;
+	const uint32_t blockSize = factor * factor;
+
+	// Channel sums for one row of destination pixels
+	vector<uint32_t> sums(rowByteCount);
+
+	for (unsigned y = 0; y < height; ++y)
+	{
+		fill(sums.begin(), sums.end(), 0);
+
+		for (unsigned blockRow = 0; blockRow < factor; ++blockRow)
+		{
+			const BYTE* sourcePixel = source.ScanLine(y * factor + blockRow);
+			uint32_t* sum = sums.data();
+
+			for (unsigned x = 0; x < width; ++x, sum += BytesPerPixel) {
+				for (unsigned blockColumn = 0; blockColumn < factor; ++blockColumn, sourcePixel += BytesPerPixel) {
+					for (unsigned channel = 0; channel < BytesPerPixel; ++channel) {
+						sum[channel] += sourcePixel[channel];
+					}
+				}
+			}
+		}
+
+		BYTE* destPixel = dest.ScanLine(y);
+		for (unsigned i = 0; i < rowByteCount; ++i) {
+			destPixel[i] = static_cast<BYTE>((sums[i] + blockSize / 2) / blockSize);
+		}
+	}
+}
+
+FREE_IMAGE_FILTER ImageFilter::GetFIFilter(ScaleFilter scaleFilter)
+{
+	switch (scaleFilter)
+	{
+	case ScaleFilter::Bilinear:
+		return FILTER_BILINEAR;
+	case ScaleFilter::Bicubic:
+		return FILTER_BICUBIC;
+	case ScaleFilter::CatmullRom:
+		return FILTER_CATMULLROM;
+	case ScaleFilter::Lanczos:
+		return FILTER_LANCZOS3;
+	default:
+		return FILTER_BOX;
+	}
+}
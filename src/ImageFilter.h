@@ -0,0 +1,32 @@
+#pragma once
+
+#include "FreeImageBmp.h"
+#include <cstdint>
+
+// Filter used to scale source tilesets to the render scale factor
+enum class ScaleFilter : uint32_t
+{
+	Box,
+	Bilinear,
+	Bicubic,
+	CatmullRom,
+	Lanczos,
+	FastBox, // Native integer box filter. Falls back to Box when the scale does not evenly divide a tile.
+};
+
+// Resampling filters implemented directly on bitmap memory
+class ImageFilter
+{
+public:
+	// Shrink a 24 or 32 bit bitmap by an integer factor. Each destination pixel is the rounded average of a
+	// factor x factor block of source pixels. Width and height must be multiples of factor.
+	static FreeImageBmp BoxDownsample(const FreeImageBmp& source, unsigned factor);
+
+	// FreeImage filter equivalent to scaleFilter
+	static FREE_IMAGE_FILTER GetFIFilter(ScaleFilter scaleFilter);
+
+private:
+	// Pixel size is a template parameter so the channel loops unroll
+	template<unsigned BytesPerPixel>
+	static void BoxDownsampleRows(const FreeImageBmp& source, FreeImageBmp& dest, unsigned factor);
+};
@@ -1,10 +1,24 @@
 #include "ConsoleArgumentParser.h"
 #include "OP2Utility.h"
 #include "MapImager.h"
+#include "Benchmark.h"
+#include "RenderPipeline.h"
+#include "MemoryBudget.h"
+#include "ArchiveIndexFile.h"
+#include "RenderManifest.h"
 #include <string>
 #include <iostream>
 #include <stdexcept>
 #include <cstddef>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <future>
+#include <atomic>
+#include <algorithm>
+#include <exception>
+#include <cstdint>
+#include <filesystem>
 #include "Timer.h"
 
 using namespace std;
@@ -12,10 +26,25 @@ using namespace std;
 static const std::string consoleLineBreak("--------------------------------------------------");
 static const std::string version = "2.1.0";
 
+// A map or saved game to render, and the directory holding its archives and tilesets
+struct RenderJob
+{
+	string directory;
+	string filename;
+	string manifestKey; // Empty if the job is not recorded in a render manifest
+	uint64_t inputHash = 0;
+};
+
 void OutputHelp();
 void ExecuteCommand(const ConsoleArgs& consoleArgs);
-void ImageMapFromConsole(const string& mapFilename, const string& resourceDirectory, const RenderSettings& renderSettings);
-void ImageMapsInDirectoryFromConsole(const string& directory, RenderSettings renderSettings);
+vector<RenderJob> FindRenderJobsInDirectory(const string& directory, const RenderSettings& renderSettings, ArchiveIndexFile* archiveIndexFile);
+void ImageMapsFromConsole(const vector<RenderJob>& renderJobs, RenderSettings renderSettings, shared_ptr<TilesetCache> tilesetCache, RenderManifest* renderManifest);
+void ImageMapFromConsole(MapImager& mapImager, const RenderJob& renderJob, const RenderSettings& renderSettings, RenderManifest* renderManifest, ostream& output);
+vector<RenderJob> SkipUpToDateRenderJobs(const vector<RenderJob>& renderJobs, const RenderSettings& renderSettings, shared_ptr<TilesetCache> tilesetCache, RenderManifest& renderManifest);
+string FormatRenderJobKey(const RenderJob& renderJob, const RenderSettings& renderSettings);
+MapImager& GetMapImager(map<string, unique_ptr<MapImager>>& mapImagers, const string& directory, shared_ptr<TilesetCache> tilesetCache);
+vector<MapImager::RenderEstimate> EstimateRenderJobs(const vector<RenderJob>& renderJobs, const RenderSettings& renderSettings, shared_ptr<TilesetCache> tilesetCache);
+vector<std::size_t> OrderRenderJobsByCost(const vector<MapImager::RenderEstimate>& renderEstimates);
 bool IsRenderableFileExtension(const string& filename);
 
 int main(int argc, char **argv)
@@ -27,6 +56,9 @@ int main(int argc, char **argv)
 
 		ConsoleArgumentParser argumentParser;
 		ConsoleArgs consoleArgs = argumentParser.SortArguments(argc, argv);
+
+		// FreeImage is initialized once and shared by every render
+		FreeImageInitializer freeImageInitializer;
 		ExecuteCommand(consoleArgs);
 
 		//if (!consoleArgs.renderSettings.quiet)
@@ -50,52 +82,85 @@ void ExecuteCommand(const ConsoleArgs& consoleArgs)
 		return;
 	}
 
+	if (consoleArgs.renderSettings.benchmarkRequested)
+	{
+		Benchmark::Run();
+		return;
+	}
+
 	if (consoleArgs.paths.empty()) {
 		throw runtime_error("You must provide at least one file or directory. To provide the current directory, enter './'.");
 	}
 
+	// Archives unchanged since the index was saved are not parsed again
+	unique_ptr<ArchiveIndexFile> archiveIndexFile;
+	if (!consoleArgs.renderSettings.archiveIndexFilename.empty()) {
+		archiveIndexFile = make_unique<ArchiveIndexFile>(consoleArgs.renderSettings.archiveIndexFilename);
+	}
+
+	vector<RenderJob> renderJobs;
+	bool directoryRequested = false;
+
 	for (const auto& path : consoleArgs.paths)
 	{
 		if (XFile::IsDirectory(path)) {
-			ImageMapsInDirectoryFromConsole(path, consoleArgs.renderSettings);
+			vector<RenderJob> directoryRenderJobs = FindRenderJobsInDirectory(path, consoleArgs.renderSettings, archiveIndexFile.get());
+			renderJobs.insert(renderJobs.end(), directoryRenderJobs.begin(), directoryRenderJobs.end());
+			directoryRequested = true;
 		}
 		else if (IsRenderableFileExtension(path)) {
-			ImageMapFromConsole(XFile::GetFilename(path), XFile::GetDirectory(path), consoleArgs.renderSettings);
+			ResourceCatalog::Open(XFile::GetDirectory(path), archiveIndexFile.get());
+			renderJobs.push_back(RenderJob{ XFile::GetDirectory(path), XFile::GetFilename(path), "", 0 });
 		}
 		else {
 			throw runtime_error("You must provide either a directory or a file of type (.map|.OP2).");
 		}
 	}
-}
 
-// @param resourceDirectory: Directory containing archives and tilesets
-void ImageMapFromConsole(const string& mapFilename, const string& resourceDirectory, const RenderSettings& renderSettings)
-{
-	if (!renderSettings.quiet) {
-		cout << "Render initialized (May take up to 45 seconds): " + mapFilename << endl;
+	if (archiveIndexFile) {
+		archiveIndexFile->Save();
 	}
 
-	MapImager mapImager(resourceDirectory);
+	// Scaled tilesets are shared by all maps
+	auto tilesetCache = make_shared<TilesetCache>(consoleArgs.renderSettings.tilesetCacheDirectory);
 
-	try {
-		string renderFilename = mapImager.FormatRenderFilename(mapFilename, renderSettings);
-		mapImager.ImageMap(renderFilename, mapFilename, renderSettings);
+	// The manifest is kept with the renders it records
+	unique_ptr<RenderManifest> renderManifest;
+	if (consoleArgs.renderSettings.incremental) {
+		renderManifest = make_unique<RenderManifest>(
+			(std::filesystem::path(consoleArgs.renderSettings.destDirectory) / "RenderManifest.txt").string());
+		renderJobs = SkipUpToDateRenderJobs(renderJobs, consoleArgs.renderSettings, tilesetCache, *renderManifest);
+	}
 
-		if (!renderSettings.quiet) {
-			cout << "Render Saved: " + renderFilename << endl << endl;
+	try {
+		ImageMapsFromConsole(renderJobs, consoleArgs.renderSettings, tilesetCache, renderManifest.get());
+	}
+	catch (...) {
+		// Keep the record of renders completed before the error
+		if (renderManifest) {
+			renderManifest->Save();
 		}
+		throw;
 	}
-	catch (const std::exception& e) {
-		cout << e.what() << endl << endl;
+
+	if (renderManifest) {
+		renderManifest->Save();
+	}
+
+	if (directoryRequested && !consoleArgs.renderSettings.quiet)
+	{
+		cout << "Renders Complete!" << endl;
+		cout << consoleLineBreak << endl << endl;
 	}
 }
 
-void ImageMapsInDirectoryFromConsole(const string& directory, RenderSettings renderSettings)
+vector<RenderJob> FindRenderJobsInDirectory(const string& directory, const RenderSettings& renderSettings, ArchiveIndexFile* archiveIndexFile)
 {
-	ResourceManager resourceManager(directory);
+	// The catalog is shared with the MapImagers rendering the directory, so the directory is only scanned once
+	auto resourceCatalog = ResourceCatalog::Open(directory, archiveIndexFile);
 
-	vector<string> filenames = resourceManager.GetAllFilenamesOfType(".map", renderSettings.accessArchives);
-	vector<string> saveFilenames = resourceManager.GetAllFilenames(R"(.*SGAME[0-9]\.OP2)"); //Regex
+	vector<string> filenames = resourceCatalog->GetAllFilenamesOfType(".map", renderSettings.accessArchives);
+	vector<string> saveFilenames = resourceCatalog->GetAllFilenames(R"(.*SGAME[0-9]\.OP2)"); //Regex
 	
 	filenames.insert(std::end(filenames), std::begin(saveFilenames), std::end(saveFilenames));
 
@@ -117,15 +182,306 @@ void ImageMapsInDirectoryFromConsole(const string& directory, RenderSettings ren
 		cout << consoleLineBreak << endl << endl;
 	}
 
+	vector<RenderJob> renderJobs;
 	for (const auto& filename : filenames) {
-		ImageMapFromConsole(filename, directory, renderSettings);
+		renderJobs.push_back(RenderJob{ directory, filename, "", 0 });
 	}
 
-	if (!renderSettings.quiet)
+	return renderJobs;
+}
+
+// Renders maps on renderSettings.jobCount workers. Each worker owns its MapImagers, or a RenderPipeline when
+// pipelineDepth is set. Jobs are started largest map first, with idle workers taking the next remaining job.
+// A job starts once its predicted memory fits within maxMemory. Output of each render is buffered and
+// printed in job order, as soon as the render and all renders before it complete.
+void ImageMapsFromConsole(const vector<RenderJob>& renderJobs, RenderSettings renderSettings, shared_ptr<TilesetCache> tilesetCache, RenderManifest* renderManifest)
+{
+	const std::size_t workerCount = std::min<std::size_t>(renderJobs.size(),
+		renderSettings.jobCount == 0 ? ThreadPool::HardwareThreadCount() : renderSettings.jobCount);
+
+	if (workerCount <= 1 && renderSettings.pipelineDepth == 0)
 	{
-		cout << "Renders Complete!" << endl;
-		cout << consoleLineBreak << endl << endl;
+		// Maps supplied from the same directory share a MapImager
+		map<string, unique_ptr<MapImager>> mapImagers;
+
+		for (const auto& renderJob : renderJobs) {
+			ImageMapFromConsole(GetMapImager(mapImagers, renderJob.directory, tilesetCache), renderJob, renderSettings, renderManifest, cout);
+		}
+
+		return;
 	}
+
+	// Split processor cores between concurrent maps instead of giving every map a thread per core
+	if (renderSettings.threadCount == 0) {
+		renderSettings.threadCount = static_cast<unsigned>(std::max<std::size_t>(1, ThreadPool::HardwareThreadCount() / workerCount));
+	}
+
+	vector<promise<string>> renderOutputs(renderJobs.size());
+	vector<future<string>> renderOutputFutures;
+	for (auto& renderOutput : renderOutputs) {
+		renderOutputFutures.push_back(renderOutput.get_future());
+	}
+
+	// Estimates read each map header, so they are skipped when neither job order nor memory is managed
+	vector<MapImager::RenderEstimate> renderEstimates(renderJobs.size(), MapImager::RenderEstimate{ 0, 0 });
+	if (workerCount > 1 || renderSettings.maxMemory != 0) {
+		renderEstimates = EstimateRenderJobs(renderJobs, renderSettings, tilesetCache);
+	}
+
+	const vector<std::size_t> jobOrder = OrderRenderJobsByCost(renderEstimates);
+	atomic<std::size_t> nextJobOrderIndex(0);
+
+	// Stops claiming jobs, as a sequential batch would stop at the first error.
+	// Jobs are claimed by cost but reported in job order, so jobs never claimed complete without output.
+	auto skipUnclaimedJobs = [&] {
+		for (std::size_t jobOrderIndex = nextJobOrderIndex.exchange(jobOrder.size()); jobOrderIndex < jobOrder.size(); ++jobOrderIndex) {
+			renderOutputs[jobOrder[jobOrderIndex]].set_value(string());
+		}
+	};
+
+	MemoryBudget memoryBudget(renderSettings.maxMemory);
+
+	ThreadPool workerPool(workerCount);
+	vector<future<void>> workers;
+
+	for (std::size_t worker = 0; worker < workerCount; ++worker)
+	{
+		workers.push_back(workerPool.Enqueue([&] {
+			if (renderSettings.pipelineDepth != 0)
+			{
+				RenderPipeline renderPipeline(renderSettings, tilesetCache, renderSettings.pipelineDepth);
+
+				renderPipeline.Run(
+					[&](std::size_t& jobIndex, string& directory, string& filename) {
+						const std::size_t jobOrderIndex = nextJobOrderIndex++;
+						if (jobOrderIndex >= jobOrder.size()) {
+							return false;
+						}
+
+						jobIndex = jobOrder[jobOrderIndex];
+						directory = renderJobs[jobIndex].directory;
+						filename = renderJobs[jobIndex].filename;
+
+						memoryBudget.Reserve(renderEstimates[jobIndex].peakMemory);
+						return true;
+					},
+					[&](std::size_t jobIndex, const string& output, const vector<string>& renderFilenames, exception_ptr error) {
+						memoryBudget.Release(renderEstimates[jobIndex].peakMemory);
+
+						if (error) {
+							skipUnclaimedJobs();
+							renderOutputs[jobIndex].set_exception(error);
+							return;
+						}
+
+						if (renderManifest && !renderFilenames.empty() && !renderJobs[jobIndex].manifestKey.empty()) {
+							renderManifest->Update(renderJobs[jobIndex].manifestKey, renderJobs[jobIndex].inputHash, renderFilenames);
+						}
+
+						renderOutputs[jobIndex].set_value(output);
+					});
+
+				return;
+			}
+
+			map<string, unique_ptr<MapImager>> mapImagers;
+
+			for (std::size_t jobOrderIndex = nextJobOrderIndex++; jobOrderIndex < jobOrder.size(); jobOrderIndex = nextJobOrderIndex++)
+			{
+				const std::size_t jobIndex = jobOrder[jobOrderIndex];
+				memoryBudget.Reserve(renderEstimates[jobIndex].peakMemory);
+
+				try {
+					ostringstream output;
+					ImageMapFromConsole(GetMapImager(mapImagers, renderJobs[jobIndex].directory, tilesetCache),
+						renderJobs[jobIndex], renderSettings, renderManifest, output);
+
+					renderOutputs[jobIndex].set_value(output.str());
+				}
+				catch (...) {
+					skipUnclaimedJobs();
+					renderOutputs[jobIndex].set_exception(current_exception());
+				}
+
+				// With limited memory, framebuffers are only kept while rendering
+				if (renderSettings.maxMemory != 0) {
+					for (auto& mapImager : mapImagers) {
+						mapImager.second->ReleaseFramebuffer();
+					}
+				}
+
+				memoryBudget.Release(renderEstimates[jobIndex].peakMemory);
+			}
+		}));
+	}
+
+	exception_ptr renderException;
+	for (auto& renderOutputFuture : renderOutputFutures)
+	{
+		try {
+			cout << renderOutputFuture.get() << flush;
+		}
+		catch (...) {
+			renderException = current_exception();
+			break;
+		}
+	}
+
+	// Wait for every worker before reporting an error so no worker outlives the batch
+	for (auto& worker : workers) {
+		worker.get();
+	}
+
+	if (renderException) {
+		rethrow_exception(renderException);
+	}
+}
+
+// @param mapImager: Created for the directory containing the map, archives and tilesets
+// @param renderManifest: Records the saved renders of jobs with a manifest key. May be nullptr.
+void ImageMapFromConsole(MapImager& mapImager, const RenderJob& renderJob, const RenderSettings& renderSettings, RenderManifest* renderManifest, ostream& output)
+{
+	const string& mapFilename = renderJob.filename;
+
+	if (!renderSettings.quiet) {
+		output << "Render initialized (May take up to 45 seconds): " + mapFilename << endl;
+	}
+
+	// Keep FreeImage messages raised by this render with its other output
+	RenderManager::SetThreadMessageStream(&output);
+
+	try {
+		vector<string> renderFilenames = mapImager.ImageMap(mapFilename, renderSettings);
+
+		if (renderManifest && !renderJob.manifestKey.empty()) {
+			renderManifest->Update(renderJob.manifestKey, renderJob.inputHash, renderFilenames);
+		}
+
+		if (!renderSettings.quiet)
+		{
+			for (const auto& renderFilename : renderFilenames) {
+				output << "Render Saved: " + renderFilename << endl;
+			}
+			output << endl;
+		}
+	}
+	catch (const std::exception& e) {
+		output << e.what() << endl << endl;
+	}
+
+	RenderManager::SetThreadMessageStream(nullptr);
+}
+
+// Returns the jobs whose map or tilesets changed, or whose renders are missing, since the manifest was saved.
+// Jobs whose inputs cannot be read are kept without a manifest key, and report their error when rendered.
+vector<RenderJob> SkipUpToDateRenderJobs(const vector<RenderJob>& renderJobs, const RenderSettings& renderSettings, shared_ptr<TilesetCache> tilesetCache, RenderManifest& renderManifest)
+{
+	map<string, unique_ptr<MapImager>> mapImagers;
+
+	vector<RenderJob> outOfDateRenderJobs;
+	for (auto renderJob : renderJobs)
+	{
+		try {
+			renderJob.inputHash = GetMapImager(mapImagers, renderJob.directory, tilesetCache).HashRenderInputs(renderJob.filename, renderSettings);
+			renderJob.manifestKey = FormatRenderJobKey(renderJob, renderSettings);
+		}
+		catch (const std::exception&) {
+			outOfDateRenderJobs.push_back(renderJob);
+			continue;
+		}
+
+		vector<string> renderFilenames;
+		if (!renderManifest.IsUpToDate(renderJob.manifestKey, renderJob.inputHash, renderFilenames)) {
+			outOfDateRenderJobs.push_back(renderJob);
+			continue;
+		}
+
+		if (!renderSettings.quiet) {
+			for (const auto& renderFilename : renderFilenames) {
+				cout << "Render Up To Date: " + renderFilename << endl;
+			}
+		}
+	}
+
+	if (!renderSettings.quiet && outOfDateRenderJobs.size() != renderJobs.size()) {
+		cout << "Skipped " << renderJobs.size() - outOfDateRenderJobs.size() << " unchanged map(s)" << endl << endl;
+	}
+
+	return outOfDateRenderJobs;
+}
+
+// Settings that change the saved renders are part of the key, so renders of other settings are recorded separately.
+// The version is included so renders are repeated after upgrading.
+string FormatRenderJobKey(const RenderJob& renderJob, const RenderSettings& renderSettings)
+{
+	const auto mapPath = std::filesystem::absolute(
+		std::filesystem::path(renderJob.directory.empty() ? "." : renderJob.directory) / renderJob.filename).lexically_normal();
+	const auto destPath = std::filesystem::absolute(renderSettings.destDirectory).lexically_normal();
+
+	ostringstream jobKey;
+	jobKey << version << '|' << mapPath.string() << '|' << destPath.string() << "|s";
+
+	vector<unsigned> scaleFactors = renderSettings.scaleFactors;
+	sort(scaleFactors.begin(), scaleFactors.end());
+	scaleFactors.erase(unique(scaleFactors.begin(), scaleFactors.end()), scaleFactors.end());
+	for (std::size_t i = 0; i < scaleFactors.size(); ++i) {
+		jobKey << (i == 0 ? "" : ",") << scaleFactors[i];
+	}
+
+	jobKey << "|i" << static_cast<int>(renderSettings.imageFormat) <<
+		"|f" << static_cast<int>(renderSettings.scaleFilter) <<
+		"|x" << (renderSettings.indexed ? 1 : 0) <<
+		"|z" << static_cast<int>(renderSettings.pngPreset) <<
+		"|t" << renderSettings.pyramidTileSize <<
+		"|l" << (renderSettings.linkDuplicateTiles ? 1 : 0);
+
+	return jobKey.str();
+}
+
+MapImager& GetMapImager(map<string, unique_ptr<MapImager>>& mapImagers, const string& directory, shared_ptr<TilesetCache> tilesetCache)
+{
+	auto& mapImager = mapImagers[directory];
+	if (!mapImager) {
+		mapImager = make_unique<MapImager>(directory, tilesetCache);
+	}
+
+	return *mapImager;
+}
+
+// Jobs whose map header cannot be read are estimated at zero cost, and report their error when rendered
+vector<MapImager::RenderEstimate> EstimateRenderJobs(const vector<RenderJob>& renderJobs, const RenderSettings& renderSettings, shared_ptr<TilesetCache> tilesetCache)
+{
+	map<string, unique_ptr<MapImager>> mapImagers;
+
+	vector<MapImager::RenderEstimate> renderEstimates;
+	for (const auto& renderJob : renderJobs)
+	{
+		MapImager::RenderEstimate renderEstimate{ 0, 0 };
+		try {
+			renderEstimate = GetMapImager(mapImagers, renderJob.directory, tilesetCache).EstimateRender(renderJob.filename, renderSettings);
+		}
+		catch (const std::exception&) { }
+
+		renderEstimates.push_back(renderEstimate);
+	}
+
+	return renderEstimates;
+}
+
+// Returns job indices sorted by descending predicted render cost
+vector<std::size_t> OrderRenderJobsByCost(const vector<MapImager::RenderEstimate>& renderEstimates)
+{
+	vector<std::size_t> jobOrder(renderEstimates.size());
+	for (std::size_t i = 0; i < jobOrder.size(); ++i) {
+		jobOrder[i] = i;
+	}
+
+	// Stable, so maps of equal size render in the order given
+	stable_sort(jobOrder.begin(), jobOrder.end(), [&renderEstimates](std::size_t left, std::size_t right) {
+		return renderEstimates[left].renderCost > renderEstimates[right].renderCost;
+	});
+
+	return jobOrder;
 }
 
 bool IsRenderableFileExtension(const std::string& filename)
@@ -155,9 +511,38 @@ void OutputHelp()
 	cout << "  -Q / --Quiet: [Default false] Add switch to run application without issuing console messages." << endl;
 	cout << "  -O / --Overwrite: [Default false] Add switch to allow application to overwrite existing files." << endl;
 	cout << "  -D / --DestinationDirectory: [Default MapRenders]. Add switch and name of new destination path." << endl;
-	cout << "  -I / --ImageFormat: [Default PNG]. Allows PNG|JPG|BMP. Sets the image format of the final render." << endl;
+	cout << "  -I / --ImageFormat: [Default PNG]. Allows PNG|JPG|BMP|QOI|PPM|PAM. Sets the image format of the final render." << endl;
+	cout << "    * QOI is lossless and encodes much faster than PNG. PPM and PAM store uncompressed pixels for other tools." << endl;
 	cout << "  -S / --Scale: [Default 4] Sets Scale Factor of image." << endl;
+	cout << "    * Accepts a comma separated list (such as 1,4,32) to render several scales from a single map read." << endl;
 	cout << "  -A / --AccessArchives [Default true]. Add switch to disable searching VOL archives for map and well files." << endl;
+	cout << "  -T / --Threads: [Default 0] Sets the number of threads rendering each map. 0 uses all processor cores." << endl;
+	cout << "  -J / --Jobs: [Default 1] Sets the number of maps rendered at once. 0 renders one map per processor core." << endl;
+	cout << "    * When rendering several maps at once, Threads defaults to sharing processor cores between the maps." << endl;
+	cout << "    * The largest maps start first. Console output stays in the order maps were found." << endl;
+	cout << "  -R / --StreamRows: [Default 0] Renders and saves this many rows of tiles at a time to limit memory use." << endl;
+	cout << "    * Supports every format except JPG. 0 renders the entire map in memory before saving." << endl;
+	cout << "  -Y / --TilePyramid: [Default 0] Writes a zoom/x/y pyramid of tiles this many pixels across, such as 256, for web map viewers." << endl;
+	cout << "    * Each zoom level is drawn from tilesets scaled to it, one row of tiles at a time. Zoom 0 is the smallest level." << endl;
+	cout << "    * Replaces the Scale switch. Tiles are written to a .tiles directory, described by its tiles.json. 0 writes whole renders." << endl;
+	cout << "  -L / --LinkDuplicateTiles: [Default false] Add switch to store identical TilePyramid tiles once, hard linking the duplicates." << endl;
+	cout << "    * Tiles drawn from the same map tiles are linked without rendering. Files are copied where hard links are unsupported." << endl;
+	cout << "  -P / --Pipeline: [Default 0] Overlaps reading, rendering, encoding and writing of consecutive maps." << endl;
+	cout << "    * Sets how many maps may wait between stages. 0 completes each map before starting the next." << endl;
+	cout << "  -M / --MaxMemory: [Default 0] Limits the predicted memory, in megabytes, of maps rendered at once." << endl;
+	cout << "    * A map starts once it fits. A map larger than the limit renders alone. 0 does not limit memory." << endl;
+	cout << "  -C / --TilesetCache: [Default none] Stores scaled tilesets in the given directory so later runs skip scaling them." << endl;
+	cout << "  -F / --Filter: [Default CatmullRom] Allows Box|Bilinear|Bicubic|CatmullRom|Lanczos|FastBox. Sets the filter used to scale tilesets." << endl;
+	cout << "    * FastBox is a native box filter for scales that evenly divide 32 (fastest, suited to small previews)." << endl;
+	cout << "  -Z / --PngPreset: [Default Balanced] Allows Fast|Balanced|Small. Trades PNG encoding time against file size." << endl;
+	cout << "    * Fast suits previews and Small suits archived renders. The Benchmark switch measures each preset." << endl;
+	cout << "  -N / --Indexed: [Default false] Add switch to render 8 bit indexed color, using a third of the memory of full color." << endl;
+	cout << "    * The palette merges the colors of the map's tilesets, reduced to 256 colors when there are more." << endl;
+	cout << "  -U / --Incremental: [Default false] Add switch to skip maps whose map and tileset files are unchanged since they were rendered." << endl;
+	cout << "    * Renders are recorded in RenderManifest.txt in the destination directory. A map renders again if its renders are missing." << endl;
+	cout << "  -X / --ArchiveIndex: [Default none] Stores the contents of VOL archives in the given file so later runs skip reading archive indexes." << endl;
+	cout << "    * An archive is read again when its size or modification time changes." << endl;
+	cout << "  -B / --Benchmark: Measures render performance on synthetic maps instead of rendering files." << endl;
 	cout << endl;
 	cout << "For more information about Outpost 2 visit the Outpost Universe (http://outpost2.net/)." << endl;
 	cout << "Image Manipulation accomplished through FreeImage (http://freeimage.sourceforge.net/)." << endl;
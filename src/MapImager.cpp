@@ -1,32 +1,448 @@
 #include "MapImager.h"
 #include "OP2Utility.h"
+#include "ContentHash.h"
+#include "ImageFilter.h"
+#include "TilesetPalette.h"
 #include <iostream>
 #include <memory>
 #include <stdexcept>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <future>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <zlib.h>
 
 using namespace std;
 
-void MapImager::ImageMap(const string& renderFilename, const string& filename, const RenderSettings& renderSettings)
+vector<string> MapImager::ImageMap(const string& filename, const RenderSettings& renderSettings)
 {
+	// Every zoom level of a tile pyramid is streamed, so all levels are prepared up front
+	if (renderSettings.pyramidTileSize != 0) {
+		PreparedMap preparedMap = PrepareMap(filename, renderSettings);
+		XFile::NewDirectory(renderSettings.destDirectory);
+		return { RenderPyramid(preparedMap, renderSettings) };
+	}
+
 	Map map = ReadMap(filename, renderSettings.accessArchives);
 
-	RenderManager::Initialize();
+	XFile::NewDirectory(renderSettings.destDirectory);
 
-	RenderManager renderManager(map.WidthInTiles(), map.HeightInTiles(), 24, renderSettings.scaleFactor);
+	vector<string> renderFilenames;
+	ScaledTilesets tilesets;
+	unsigned previousScaleFactor = 0;
+
+	for (const auto scaleFactor : GetRenderScaleFactors(renderSettings))
+	{
+		tilesets = GetScaledTilesets(map, scaleFactor, previousScaleFactor, tilesets, renderSettings);
 
-	LoadTilesets(map, renderManager, renderSettings.accessArchives);
-	SetRenderTiles(map, renderManager);
+		const string renderFilename = FormatRenderFilename(filename, renderSettings, scaleFactor);
+		RenderMap(renderFilename, map, GetRenderTilesets(map, scaleFactor, tilesets, renderSettings), scaleFactor, renderSettings);
+
+		renderFilenames.push_back(renderFilename);
+		previousScaleFactor = scaleFactor;
+	}
+
+	return renderFilenames;
+}
+
+MapImager::PreparedMap MapImager::PrepareMap(const string& filename, const RenderSettings& renderSettings)
+{
+	PreparedMap preparedMap{ filename, ReadMap(filename, renderSettings.accessArchives), {} };
+
+	ScaledTilesets tilesets;
+	unsigned previousScaleFactor = 0;
+
+	const auto scaleFactors = renderSettings.pyramidTileSize == 0 ? GetRenderScaleFactors(renderSettings) :
+		GetPyramidScaleFactors(preparedMap.map.WidthInTiles(), preparedMap.map.HeightInTiles(), renderSettings.pyramidTileSize);
+
+	for (const auto scaleFactor : scaleFactors)
+	{
+		tilesets = GetScaledTilesets(preparedMap.map, scaleFactor, previousScaleFactor, tilesets, renderSettings);
+		preparedMap.scaledTilesets.emplace_back(scaleFactor, GetRenderTilesets(preparedMap.map, scaleFactor, tilesets, renderSettings));
+
+		previousScaleFactor = scaleFactor;
+	}
 
+	return preparedMap;
+}
+
+vector<MapImager::MapRender> MapImager::RenderPreparedMap(PreparedMap& preparedMap, const RenderSettings& renderSettings)
+{
 	XFile::NewDirectory(renderSettings.destDirectory);
 
-	renderManager.SaveMapImage(renderFilename, renderSettings.imageFormat);
+	// Pyramid tiles are saved as they render, leaving nothing to encode
+	if (renderSettings.pyramidTileSize != 0) {
+		vector<MapRender> mapRenders;
+		mapRenders.push_back(MapRender{ RenderPyramid(preparedMap, renderSettings), nullptr });
+		return mapRenders;
+	}
+
+	const unsigned mapTileWidth = preparedMap.map.WidthInTiles();
+	const unsigned mapTileHeight = preparedMap.map.HeightInTiles();
+
+	vector<MapRender> mapRenders;
+
+	for (const auto& scaledTilesets : preparedMap.scaledTilesets)
+	{
+		const unsigned scaleFactor = scaledTilesets.first;
+		const string renderFilename = FormatRenderFilename(preparedMap.filename, renderSettings, scaleFactor);
+
+		// Bands are saved as they render, so the reused framebuffer is free again once RenderMap returns
+		if (renderSettings.streamTileRows != 0) {
+			RenderMap(renderFilename, preparedMap.map, scaledTilesets.second, scaleFactor, renderSettings);
+			mapRenders.push_back(MapRender{ renderFilename, nullptr });
+			continue;
+		}
+
+		// Each render gets its own image, since the previous render may still be encoding
+		auto renderManager = std::make_unique<RenderManager>(mapTileWidth, mapTileHeight, GetRenderBpp(renderSettings), scaleFactor);
+		for (const auto& tileset : scaledTilesets.second) {
+			renderManager->AddTileset(tileset);
+		}
+
+		SetRenderTiles(preparedMap.map, *renderManager, 0, mapTileHeight, renderSettings.threadCount);
+
+		mapRenders.push_back(MapRender{ renderFilename, std::move(renderManager) });
+	}
 
-	RenderManager::Deinitialize();
+	return mapRenders;
 }
 
-string MapImager::FormatRenderFilename(const string& filename, const RenderSettings& renderSettings)
+// Largest first without duplicates, so with a box filter smaller scales may filter tilesets from the previous scale
+vector<unsigned> MapImager::GetRenderScaleFactors(const RenderSettings& renderSettings)
+{
+	vector<unsigned> scaleFactors = renderSettings.scaleFactors;
+	sort(scaleFactors.rbegin(), scaleFactors.rend());
+	scaleFactors.erase(unique(scaleFactors.begin(), scaleFactors.end()), scaleFactors.end());
+
+	return scaleFactors;
+}
+
+// Full size tiles first, halving down to the first scale where the whole map fits in one pyramid tile.
+// Tilesets cannot be scaled below one pixel per tile, so a large map may not reach a single pyramid tile.
+vector<unsigned> MapImager::GetPyramidScaleFactors(uint64_t mapTileWidth, uint64_t mapTileHeight, unsigned pyramidTileSize)
+{
+	vector<unsigned> scaleFactors;
+
+	for (unsigned scaleFactor = PyramidMaxScaleFactor; scaleFactor >= 1; scaleFactor /= 2)
+	{
+		scaleFactors.push_back(scaleFactor);
+
+		if (mapTileWidth * scaleFactor <= pyramidTileSize && mapTileHeight * scaleFactor <= pyramidTileSize) {
+			break;
+		}
+	}
+
+	return scaleFactors;
+}
+
+// Box filtering the previous scale matches box filtering the source tilesets. Other filters always scale from the source.
+MapImager::ScaledTilesets MapImager::GetScaledTilesets(Map& map, unsigned scaleFactor, unsigned previousScaleFactor,
+	const ScaledTilesets& previousTilesets, const RenderSettings& renderSettings)
+{
+	const bool boxFilter = renderSettings.scaleFilter == ScaleFilter::Box || renderSettings.scaleFilter == ScaleFilter::FastBox;
+
+	if (boxFilter && previousScaleFactor != 0 && previousScaleFactor % scaleFactor == 0) {
+		return DownscaleTilesets(previousTilesets, previousScaleFactor / scaleFactor);
+	}
+
+	return LoadTilesets(map, scaleFactor, TilesetBpp, renderSettings.scaleFilter, renderSettings.accessArchives);
+}
+
+// Tilesets are scaled and cached in full color. Indexed renders convert them once per batch for each set of tilesets
+// and scale, since maps sharing tilesets share the conversion. Chained box filter downscales match the tilesets
+// scaled from the source, so the cache keys of the scale identify them too.
+MapImager::ScaledTilesets MapImager::GetRenderTilesets(Map& map, unsigned scaleFactor, const ScaledTilesets& tilesets,
+	const RenderSettings& renderSettings)
+{
+	if (!renderSettings.indexed) {
+		return tilesets;
+	}
+
+	const auto cacheKeys = GetTilesetCacheKeys(map, scaleFactor, TilesetBpp, renderSettings.scaleFilter);
+
+	auto indexedTilesets = tilesetCache->FindIndexed(cacheKeys);
+	if (indexedTilesets.empty()) {
+		indexedTilesets = TilesetPalette::ConvertToIndexed(tilesets);
+		tilesetCache->InsertIndexed(cacheKeys, indexedTilesets);
+	}
+
+	return indexedTilesets;
+}
+
+unsigned MapImager::GetRenderBpp(const RenderSettings& renderSettings)
+{
+	return renderSettings.indexed ? 8 : TilesetBpp;
+}
+
+// With streamTileRows set, renders and saves that many rows of tiles at a time,
+// so peak memory depends on band height instead of map height
+void MapImager::RenderMap(const string& renderFilename, Map& map, const ScaledTilesets& tilesets, unsigned scaleFactor, const RenderSettings& renderSettings)
+{
+	const unsigned mapTileWidth = map.WidthInTiles();
+	const unsigned mapTileHeight = map.HeightInTiles();
+	const unsigned bandTileHeight = renderSettings.streamTileRows == 0 ?
+		mapTileHeight : std::min(renderSettings.streamTileRows, mapTileHeight);
+
+	RenderManager renderManager(mapTileWidth, mapTileHeight, scaleFactor,
+		AcquireFramebuffer(mapTileWidth * scaleFactor, bandTileHeight * scaleFactor, GetRenderBpp(renderSettings)));
+
+	for (const auto& tileset : tilesets) {
+		renderManager.AddTileset(tileset);
+	}
+
+	if (renderSettings.streamTileRows == 0) {
+		SetRenderTiles(map, renderManager, 0, mapTileHeight, renderSettings.threadCount);
+		renderManager.SaveMapImage(renderFilename, renderSettings.imageFormat, renderSettings.pngPreset,
+			&GetRenderThreadPool(renderSettings.threadCount));
+		return;
+	}
+
+	auto scanlineWriter = renderManager.CreateScanlineWriter(renderFilename, renderSettings.imageFormat, renderSettings.pngPreset,
+		&GetRenderThreadPool(renderSettings.threadCount));
+
+	for (unsigned firstTileRow = 0; firstTileRow < mapTileHeight; firstTileRow += bandTileHeight)
+	{
+		const unsigned endTileRow = std::min(firstTileRow + bandTileHeight, mapTileHeight);
+
+		renderManager.SetBand(firstTileRow);
+		SetRenderTiles(map, renderManager, firstTileRow, endTileRow, renderSettings.threadCount);
+		renderManager.WriteBand(*scanlineWriter, endTileRow - firstTileRow);
+	}
+
+	scanlineWriter->Finish();
+}
+
+// Writes pyramidDirectory/zoom/x/y image files, zoom 0 being the smallest scale. Returns the filename of a
+// description of the pyramid, which is written last so it only exists once every tile is saved.
+string MapImager::RenderPyramid(PreparedMap& preparedMap, const RenderSettings& renderSettings)
+{
+	const std::filesystem::path pyramidDirectory(FormatPyramidDirectory(preparedMap.filename, renderSettings));
+	const unsigned minScaleFactor = preparedMap.scaledTilesets.back().first;
+
+	PyramidTileStore tileStore;
+
+	unsigned maxZoom = 0;
+	for (const auto& scaledTilesets : preparedMap.scaledTilesets)
+	{
+		const unsigned scaleFactor = scaledTilesets.first;
+
+		unsigned zoom = 0;
+		while ((minScaleFactor << zoom) < scaleFactor) {
+			++zoom;
+		}
+		maxZoom = std::max(maxZoom, zoom);
+
+		RenderPyramidLevel((pyramidDirectory / to_string(zoom)).string(), preparedMap.map, scaledTilesets.second, scaleFactor,
+			renderSettings, tileStore);
+	}
+
+	const string descriptionFilename = (pyramidDirectory / "tiles.json").string();
+	std::ofstream description(descriptionFilename, std::ios::out | std::ios::trunc);
+	description << "{\n" <<
+		"\t\"tileSize\": " << renderSettings.pyramidTileSize << ",\n" <<
+		"\t\"minZoom\": 0,\n" <<
+		"\t\"maxZoom\": " << maxZoom << ",\n" <<
+		"\t\"width\": " << preparedMap.map.WidthInTiles() * (minScaleFactor << maxZoom) << ",\n" <<
+		"\t\"height\": " << preparedMap.map.HeightInTiles() * (minScaleFactor << maxZoom) << ",\n" <<
+		"\t\"format\": \"" << GetImageFormatExtension(renderSettings.imageFormat).substr(1) << "\",\n" <<
+		"\t\"tileCount\": " << tileStore.tileCount << ",\n" <<
+		"\t\"storedTileCount\": " << tileStore.storedTileCount << "\n" <<
+		"}\n";
+	description.close();
+
+	if (!description) {
+		throw std::runtime_error("Error writing tile pyramid description: " + descriptionFilename);
+	}
+
+	return descriptionFilename;
+}
+
+// Renders one band of pyramid tiles at a time, so memory is bounded by the level width rather than its area.
+// Tiles on the right and bottom edges are cropped to the level size.
+void MapImager::RenderPyramidLevel(const string& levelDirectory, Map& map, const ScaledTilesets& tilesets, unsigned scaleFactor,
+	const RenderSettings& renderSettings, PyramidTileStore& tileStore)
+{
+	const unsigned pyramidTileSize = renderSettings.pyramidTileSize;
+	const unsigned mapTileWidth = map.WidthInTiles();
+	const unsigned mapTileHeight = map.HeightInTiles();
+	const unsigned bandTileHeight = std::min(pyramidTileSize / scaleFactor, mapTileHeight);
+
+	RenderManager renderManager(mapTileWidth, mapTileHeight, scaleFactor,
+		AcquireFramebuffer(mapTileWidth * scaleFactor, bandTileHeight * scaleFactor, GetRenderBpp(renderSettings)));
+
+	for (const auto& tileset : tilesets) {
+		renderManager.AddTileset(tileset);
+	}
+
+	const unsigned levelWidth = renderManager.Width();
+	const unsigned columnCount = (levelWidth + pyramidTileSize - 1) / pyramidTileSize;
+	const string extension = GetImageFormatExtension(renderSettings.imageFormat);
+
+	for (unsigned x = 0; x < columnCount; ++x) {
+		std::filesystem::create_directories(std::filesystem::path(levelDirectory) / to_string(x));
+	}
+
+	// Pyramid tiles drawn from the same map tiles of this level, by a hash of the map tiles they cover
+	std::map<TileKey, string> tilesByMapTiles;
+
+	unsigned y = 0;
+	for (unsigned firstTileRow = 0; firstTileRow < mapTileHeight; firstTileRow += bandTileHeight, ++y)
+	{
+		const unsigned endTileRow = std::min(firstTileRow + bandTileHeight, mapTileHeight);
+		const unsigned rowHeight = (endTileRow - firstTileRow) * scaleFactor;
+
+		auto getTileFilename = [&](std::size_t x) {
+			return (std::filesystem::path(levelDirectory) / to_string(x) / (to_string(y) + extension)).string();
+		};
+		auto getTileWidth = [&](std::size_t x) {
+			return std::min(pyramidTileSize, levelWidth - static_cast<unsigned>(x) * pyramidTileSize);
+		};
+
+		// An existing tile may be hard linked to others by an earlier run, so it is replaced rather than written through
+		auto saveTile = [&](std::size_t x) {
+			const string tileFilename = getTileFilename(x);
+			std::error_code errorCode;
+			std::filesystem::remove(tileFilename, errorCode);
+
+			renderManager.SaveBandRegion(tileFilename, renderSettings.imageFormat, renderSettings.pngPreset,
+				static_cast<unsigned>(x) * pyramidTileSize, 0, getTileWidth(x), rowHeight);
+		};
+
+		renderManager.SetBand(firstTileRow);
+		tileStore.tileCount += columnCount;
+
+		if (!renderSettings.linkDuplicateTiles)
+		{
+			SetRenderTiles(map, renderManager, firstTileRow, endTileRow, renderSettings.threadCount);
+
+			RunOnRenderThreads(columnCount, renderSettings.threadCount, saveTile);
+
+			tileStore.storedTileCount += columnCount;
+			continue;
+		}
+
+		// A tile covering the same map tiles as an earlier tile of this level is identical, so it is linked without rendering
+		const unsigned columnTileWidth = pyramidTileSize / scaleFactor;
+		vector<string> tileSources(columnCount);
+		vector<std::size_t> renderedColumns;
+
+		for (unsigned x = 0; x < columnCount; ++x)
+		{
+			const unsigned firstTileColumn = x * columnTileWidth;
+			const unsigned endTileColumn = std::min(firstTileColumn + columnTileWidth, mapTileWidth);
+			const TileKey mapTilesKey = HashMapTiles(map, firstTileColumn, endTileColumn, firstTileRow, endTileRow);
+
+			auto insertResult = tilesByMapTiles.emplace(mapTilesKey, getTileFilename(x));
+			if (insertResult.second) {
+				renderedColumns.push_back(x);
+			}
+			else {
+				tileSources[x] = insertResult.first->second;
+			}
+		}
+
+		// Render the remaining tiles, hashing their pixels
+		vector<TileKey> pixelKeys(columnCount);
+		RunOnRenderThreads(renderedColumns.size(), renderSettings.threadCount, [&](std::size_t i) {
+			const unsigned x = static_cast<unsigned>(renderedColumns[i]);
+			const unsigned firstTileColumn = x * columnTileWidth;
+
+			SetRenderTileRegion(map, renderManager, firstTileColumn, std::min(firstTileColumn + columnTileWidth, mapTileWidth),
+				firstTileRow, endTileRow);
+
+			const auto pixelHash = renderManager.HashBandRegion(x * pyramidTileSize, 0, getTileWidth(x), rowHeight);
+			pixelKeys[x] = TileKey(pixelHash.first, pixelHash.second, getTileWidth(x), rowHeight);
+		});
+
+		// Tiles with the same pixels as a tile saved anywhere in the pyramid are linked instead of encoded.
+		// Decided in column order, so the saved copy does not depend on thread timing.
+		vector<std::size_t> savedColumns;
+		for (const auto x : renderedColumns)
+		{
+			auto insertResult = tileStore.tilesByPixels.emplace(pixelKeys[x], getTileFilename(x));
+			if (insertResult.second) {
+				savedColumns.push_back(x);
+			}
+			else {
+				tileSources[x] = insertResult.first->second;
+			}
+		}
+
+		RunOnRenderThreads(savedColumns.size(), renderSettings.threadCount, [&](std::size_t i) {
+			saveTile(savedColumns[i]);
+		});
+
+		for (unsigned x = 0; x < columnCount; ++x) {
+			if (!tileSources[x].empty()) {
+				LinkPyramidTile(tileSources[x], getTileFilename(x));
+			}
+		}
+
+		tileStore.storedTileCount += savedColumns.size();
+	}
+}
+
+// Hashes the tileset and tile indexes of a rectangle of map tiles, along with its size
+MapImager::TileKey MapImager::HashMapTiles(Map& map, unsigned firstTileColumn, unsigned endTileColumn, unsigned firstTileRow, unsigned endTileRow)
+{
+	vector<uint64_t> mapTiles;
+	mapTiles.reserve(static_cast<std::size_t>(endTileColumn - firstTileColumn) * (endTileRow - firstTileRow) * 2);
+
+	for (unsigned y = firstTileRow; y < endTileRow; ++y) {
+		for (unsigned x = firstTileColumn; x < endTileColumn; ++x) {
+			mapTiles.push_back(map.GetTilesetIndex(x, y));
+			mapTiles.push_back(map.GetImageIndex(x, y));
+		}
+	}
+
+	const std::size_t byteCount = mapTiles.size() * sizeof(uint64_t);
+	const uint64_t contentHash = ContentHash::Compute(mapTiles.data(), byteCount);
+	const uint32_t crc = static_cast<uint32_t>(crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(mapTiles.data()),
+		static_cast<uInt>(byteCount)));
+
+	return TileKey(contentHash, crc, endTileColumn - firstTileColumn, endTileRow - firstTileRow);
+}
+
+// Hard links the tile to an identical tile already saved, copying it where the file system does not support hard links
+void MapImager::LinkPyramidTile(const string& sourceFilename, const string& tileFilename)
+{
+	std::error_code errorCode;
+	std::filesystem::remove(tileFilename, errorCode);
+
+	std::filesystem::create_hard_link(sourceFilename, tileFilename, errorCode);
+	if (errorCode) {
+		std::filesystem::copy_file(sourceFilename, tileFilename, std::filesystem::copy_options::overwrite_existing);
+	}
+}
+
+string MapImager::FormatPyramidDirectory(const string& filename, const RenderSettings& renderSettings)
+{
+	string pyramidDirectory;
+
+	if (XFile::IsRootPath(renderSettings.destDirectory)) {
+		pyramidDirectory = XFile::ReplaceFilename(renderSettings.destDirectory, filename);
+	}
+	else {
+		pyramidDirectory = XFile::AppendSubDirectory(XFile::GetFilename(filename), renderSettings.destDirectory);
+	}
+
+	pyramidDirectory = XFile::ChangeFileExtension(pyramidDirectory, ".tiles");
+
+	if (!renderSettings.overwrite) {
+		pyramidDirectory = CreateUniqueFilename(pyramidDirectory);
+	}
+
+	return pyramidDirectory;
+}
+
+string MapImager::FormatRenderFilename(const string& filename, const RenderSettings& renderSettings, unsigned scaleFactor)
 {
 	string renderFilename;
 
@@ -37,7 +453,7 @@ string MapImager::FormatRenderFilename(const string& filename, const RenderSetti
 		renderFilename = XFile::AppendSubDirectory(XFile::GetFilename(filename), renderSettings.destDirectory);
 	}
 
-	string s = ".s" + to_string(renderSettings.scaleFactor);
+	string s = ".s" + to_string(scaleFactor);
 	renderFilename = XFile::AppendToFilename(renderFilename, s);
 	renderFilename = XFile::ChangeFileExtension(renderFilename, GetImageFormatExtension(renderSettings.imageFormat));
 
@@ -58,17 +474,29 @@ string MapImager::GetImageFormatExtension(ImageFormat imageFormat)
 		return ".bmp";
 	case ImageFormat::JPG:
 		return ".jpg";
+	case ImageFormat::QOI:
+		return ".qoi";
+	case ImageFormat::PPM:
+		return ".ppm";
+	case ImageFormat::PAM:
+		return ".pam";
 	default:
 		return ".bmp";
 	}
 }
 
+std::mutex MapImager::reservedFilenamesMutex;
+std::set<std::string> MapImager::reservedFilenames;
+
+// Filenames are reserved when chosen, so concurrent renders never pick the same name before either file exists
 std::string MapImager::CreateUniqueFilename(const std::string& filename)
 {
+	std::lock_guard<std::mutex> lock(reservedFilenamesMutex);
+
 	std::string uniqueFilename = filename;
 
 	std::size_t pathIndex = 0;
-	while (XFile::PathExists(uniqueFilename))
+	while (XFile::PathExists(uniqueFilename) || reservedFilenames.count(uniqueFilename) != 0)
 	{
 		pathIndex++;
 
@@ -79,11 +507,15 @@ std::string MapImager::CreateUniqueFilename(const std::string& filename)
 		uniqueFilename = XFile::AppendToFilename(filename, "_" + std::to_string(pathIndex));
 	}
 
+	reservedFilenames.insert(uniqueFilename);
 	return uniqueFilename;
 }
 
-void MapImager::LoadTilesets(Map& map, RenderManager& mapImager, bool accessArchives)
+// Keys of the tilesets a map uses, in the order of its tileset sources
+vector<TilesetCacheKey> MapImager::GetTilesetCacheKeys(Map& map, unsigned scaleFactor, unsigned bpp, ScaleFilter scaleFilter)
 {
+	vector<TilesetCacheKey> cacheKeys;
+
 	for (std::size_t i = 0; i < map.tilesetSources.size(); ++i)
 	{
 		if (map.tilesetSources[i].numTiles == 0) {
@@ -92,38 +524,280 @@ void MapImager::LoadTilesets(Map& map, RenderManager& mapImager, bool accessArch
 
 		string tilesetFilename(map.tilesetSources[i].tilesetFilename + ".bmp");
 
-		auto stream = resourceManager.GetResourceStream(tilesetFilename);
-
-		if (stream == nullptr) {
+		if (!resourceCatalog->Contains(tilesetFilename)) {
 			throw runtime_error("Unable to find the tileset " + tilesetFilename + " in the directory or in a given archive (.vol).");
 		}
 
-		using ImageBuffer = std::vector<BYTE>;
-		using ImageSize = ImageBuffer::size_type;
+		// The catalog hashes each tileset once per batch
+		cacheKeys.push_back(TilesetCacheKey{
+			StringHelper::ConvertToUpper(tilesetFilename),
+			resourceCatalog->GetContentHash(tilesetFilename),
+			scaleFactor,
+			bpp,
+			scaleFilter
+		});
+	}
+
+	return cacheKeys;
+}
+
+MapImager::ScaledTilesets MapImager::LoadTilesets(Map& map, unsigned scaleFactor, unsigned bpp, ScaleFilter scaleFilter, bool accessArchives)
+{
+	ScaledTilesets tilesets;
+
+	for (const auto& cacheKey : GetTilesetCacheKeys(map, scaleFactor, bpp, scaleFilter))
+	{
+		auto scaledTileset = tilesetCache->Find(cacheKey);
+		if (!scaledTileset) {
+			// Decoded straight from the memory mapping of the tileset's file or archive
+			const ResourceView tilesetView = resourceCatalog->GetResourceView(cacheKey.tilesetName);
+			scaledTileset = RenderManager::CreateScaledTileset(reinterpret_cast<const BYTE*>(tilesetView.data), tilesetView.size,
+				cacheKey.scaleFactor, cacheKey.bpp, cacheKey.scaleFilter);
+			tilesetCache->Insert(cacheKey, scaledTileset);
+		}
+
+		tilesets.push_back(scaledTileset);
+	}
+
+	return tilesets;
+}
+
+// Each tile is a whole number of filter blocks, so box filtering never mixes pixels of neighbouring tiles
+MapImager::ScaledTilesets MapImager::DownscaleTilesets(const ScaledTilesets& tilesets, unsigned factor)
+{
+	ScaledTilesets downscaledTilesets;
+
+	for (const auto& tileset : tilesets) {
+		downscaledTilesets.push_back(std::make_shared<const ScaledTileset>(
+			ScaledTileset{ ImageFilter::BoxDownsample(tileset->bitmap, factor), tileset->tileCount }));
+	}
+
+	return downscaledTilesets;
+}
+
+// Splits the tile rows into horizontal sections, rendered concurrently.
+// Sections write to disjoint rows of the render, so no locking is required.
+void MapImager::SetRenderTiles(Map& map, RenderManager& renderManager, unsigned firstTileRow, unsigned endTileRow, unsigned threadCount)
+{
+	const unsigned tileRowCount = endTileRow - firstTileRow;
+	ThreadPool& threadPool = GetRenderThreadPool(threadCount);
+
+	if (threadPool.ThreadCount() <= 1) {
+		SetRenderTileRows(map, renderManager, firstTileRow, endTileRow);
+		return;
+	}
+
+	// Use several sections per thread to balance load when some sections finish early
+	const std::size_t sectionCount = std::min<std::size_t>(tileRowCount, threadPool.ThreadCount() * 4);
+
+	RunOnRenderThreads(sectionCount, threadCount, [&](std::size_t section) {
+		const unsigned sectionFirstTileRow = firstTileRow + static_cast<unsigned>(tileRowCount * section / sectionCount);
+		const unsigned sectionEndTileRow = firstTileRow + static_cast<unsigned>(tileRowCount * (section + 1) / sectionCount);
+
+		SetRenderTileRows(map, renderManager, sectionFirstTileRow, sectionEndTileRow);
+	});
+}
+
+void MapImager::RunOnRenderThreads(std::size_t taskCount, unsigned threadCount, const std::function<void(std::size_t task)>& task)
+{
+	ThreadPool& threadPool = GetRenderThreadPool(threadCount);
+
+	if (threadPool.ThreadCount() <= 1 || taskCount <= 1)
+	{
+		for (std::size_t i = 0; i < taskCount; ++i) {
+			task(i);
+		}
+		return;
+	}
+
+	vector<future<void>> results;
+	for (std::size_t i = 0; i < taskCount; ++i) {
+		results.push_back(threadPool.Enqueue([&task, i] { task(i); }));
+	}
 
-		auto streamLength = stream->Length();
-		if (streamLength > std::numeric_limits<ImageSize>::max()) {
-			throw std::runtime_error("Tileset " + tilesetFilename + " is too large for OP2MapImager to load into memory");
+	// Wait for every task before reporting an error so no task outlives the render
+	exception_ptr taskException;
+	for (auto& result : results)
+	{
+		try {
+			result.get();
 		}
+		catch (...) {
+			if (!taskException) {
+				taskException = current_exception();
+			}
+		}
+	}
 
-		ImageBuffer buffer(static_cast<ImageSize>(streamLength));
-		stream->Read(buffer);
-		mapImager.AddTileset(&buffer[0], buffer.size());
+	if (taskException) {
+		rethrow_exception(taskException);
 	}
 }
 
-void MapImager::SetRenderTiles(Map& map, RenderManager& renderManager)
+void MapImager::SetRenderTileRows(Map& map, RenderManager& renderManager, unsigned firstTileRow, unsigned endTileRow)
 {
-	for (unsigned int y = 0; y < map.HeightInTiles(); ++y) {
-		for (unsigned int x = 0; x < map.WidthInTiles(); ++x) {
+	SetRenderTileRegion(map, renderManager, 0, map.WidthInTiles(), firstTileRow, endTileRow);
+}
+
+void MapImager::SetRenderTileRegion(Map& map, RenderManager& renderManager, unsigned firstTileColumn, unsigned endTileColumn,
+	unsigned firstTileRow, unsigned endTileRow)
+{
+	for (unsigned int y = firstTileRow; y < endTileRow; ++y) {
+		for (unsigned int x = firstTileColumn; x < endTileColumn; ++x) {
 			renderManager.PasteTile(map.GetTilesetIndex(x, y), map.GetImageIndex(x, y), x, y);
 		}
 	}
 }
 
+ThreadPool& MapImager::GetRenderThreadPool(unsigned threadCount)
+{
+	if (threadCount == 0) {
+		threadCount = static_cast<unsigned>(ThreadPool::HardwareThreadCount());
+	}
+
+	if (!renderThreadPool || renderThreadPool->ThreadCount() != threadCount) {
+		renderThreadPool = std::make_unique<ThreadPool>(threadCount);
+	}
+
+	return *renderThreadPool;
+}
+
+// Returns a view into a framebuffer kept between renders. The framebuffer grows to fit the largest
+// render requested, so later renders of the same or smaller size do not allocate.
+// The previous view must be released before calling again.
+FreeImageBmp MapImager::AcquireFramebuffer(unsigned width, unsigned height, unsigned bpp)
+{
+	if (!framebuffer || framebuffer->Bpp() != bpp || framebuffer->Width() < width || framebuffer->Height() < height)
+	{
+		unsigned framebufferWidth = width;
+		unsigned framebufferHeight = height;
+		if (framebuffer && framebuffer->Bpp() == bpp) {
+			framebufferWidth = std::max(width, framebuffer->Width());
+			framebufferHeight = std::max(height, framebuffer->Height());
+		}
+
+		// Release the old framebuffer before allocating the larger one to limit peak memory
+		framebuffer.reset();
+		framebuffer = std::make_unique<FreeImageBmp>(framebufferWidth, framebufferHeight, bpp);
+	}
+
+	return framebuffer->CreateView(0, 0, width, height);
+}
+
+MapImager::RenderEstimate MapImager::EstimateRender(const string& filename, const RenderSettings& renderSettings)
+{
+	uint64_t mapTileWidth;
+	uint64_t mapTileHeight;
+
+	// Saved games begin with game state of varying size, so the whole saved game is read
+	if (XFile::ExtensionMatches(filename, ".OP2")) {
+		Map map = ReadMap(filename, renderSettings.accessArchives);
+		mapTileWidth = map.WidthInTiles();
+		mapTileHeight = map.HeightInTiles();
+	}
+	else {
+		auto mapStream = resourceCatalog->GetResourceStream(filename, renderSettings.accessArchives);
+
+		if (mapStream == nullptr) {
+			throw std::runtime_error("Unable to locate " + filename + " within directory or within an archive (vol or clm) in the directory.");
+		}
+
+		// Map header: version tag, saved game flag, log2 of width in tiles, height in tiles
+		uint32_t versionTag;
+		uint32_t savedGameFlag;
+		uint32_t lgWidthInTiles;
+		uint32_t heightInTiles;
+		mapStream->Read(versionTag);
+		mapStream->Read(savedGameFlag);
+		mapStream->Read(lgWidthInTiles);
+		mapStream->Read(heightInTiles);
+
+		if (lgWidthInTiles >= 32) {
+			throw std::runtime_error("Map " + filename + " has an invalid width.");
+		}
+
+		mapTileWidth = static_cast<uint64_t>(1) << lgWidthInTiles;
+		mapTileHeight = heightInTiles;
+	}
+
+	return RenderEstimate{ mapTileWidth * mapTileHeight, EstimatePeakMemory(mapTileWidth, mapTileHeight, renderSettings) };
+}
+
+// Counts the render images, scaled tilesets of every scale and, when pipelined, encoded images.
+// Encoded images are assumed to be no larger than the render.
+uint64_t MapImager::EstimatePeakMemory(uint64_t mapTileWidth, uint64_t mapTileHeight, const RenderSettings& renderSettings)
+{
+	const uint64_t bytesPerPixel = GetRenderBpp(renderSettings) / 8;
+	const uint64_t tilesetBytesPerPixel = TilesetBpp / 8;
+	const bool pyramid = renderSettings.pyramidTileSize != 0;
+	const auto scaleFactors = pyramid ? GetPyramidScaleFactors(mapTileWidth, mapTileHeight, renderSettings.pyramidTileSize) :
+		GetRenderScaleFactors(renderSettings);
+
+	uint64_t largestRenderMemory = 0;
+	uint64_t totalRenderMemory = 0;
+	uint64_t tilesetMemory = 0;
+
+	for (const auto scaleFactor : scaleFactors)
+	{
+		// Tile pyramids render one row of pyramid tiles at a time
+		uint64_t bandTileHeight = renderSettings.streamTileRows == 0 ?
+			mapTileHeight : std::min<uint64_t>(renderSettings.streamTileRows, mapTileHeight);
+		if (pyramid) {
+			bandTileHeight = std::min<uint64_t>(renderSettings.pyramidTileSize / scaleFactor, mapTileHeight);
+		}
+
+		const uint64_t tilePixelCount = static_cast<uint64_t>(scaleFactor) * scaleFactor;
+		const uint64_t renderMemory = mapTileWidth * bandTileHeight * tilePixelCount * bytesPerPixel;
+
+		largestRenderMemory = std::max(largestRenderMemory, renderMemory);
+		totalRenderMemory += renderMemory;
+
+		// Indexed renders hold an indexed copy of the tilesets alongside the full color tilesets
+		tilesetMemory += EstimatedTilesetTileCount * tilePixelCount * tilesetBytesPerPixel;
+		if (renderSettings.indexed) {
+			tilesetMemory += EstimatedTilesetTileCount * tilePixelCount;
+		}
+	}
+
+	// A pipelined map holds an image for each scale until it is written. Otherwise scales reuse one framebuffer.
+	if (renderSettings.pipelineDepth != 0 && renderSettings.streamTileRows == 0 && !pyramid) {
+		return 2 * totalRenderMemory + tilesetMemory;
+	}
+
+	return largestRenderMemory + tilesetMemory;
+}
+
+void MapImager::ReleaseFramebuffer()
+{
+	framebuffer.reset();
+}
+
+// Mixes the contents of the map and each of its tilesets, so any change to what a render is drawn from changes the hash
+uint64_t MapImager::HashRenderInputs(const string& filename, const RenderSettings& renderSettings)
+{
+	uint64_t inputHash = resourceCatalog->GetContentHash(filename, renderSettings.accessArchives);
+
+	Map map = ReadMap(filename, renderSettings.accessArchives);
+
+	for (const auto& tilesetSource : map.tilesetSources)
+	{
+		if (tilesetSource.numTiles == 0) {
+			continue;
+		}
+
+		const string tilesetFilename = StringHelper::ConvertToUpper(tilesetSource.tilesetFilename + ".bmp");
+		const uint64_t tilesetHash = resourceCatalog->GetContentHash(tilesetFilename);
+
+		inputHash = ContentHash::Compute(tilesetFilename.data(), tilesetFilename.size(), inputHash);
+		inputHash = ContentHash::Compute(&tilesetHash, sizeof(tilesetHash), inputHash);
+	}
+
+	return inputHash;
+}
+
 Map MapImager::ReadMap(const string& filename, bool accessArchives)
 {
-	auto mapStream = resourceManager.GetResourceStream(filename, accessArchives);
+	auto mapStream = resourceCatalog->GetResourceStream(filename, accessArchives);
 
 	if (mapStream == nullptr) {
 		throw std::runtime_error("Unable to locate " + filename + " within directory or within an archive (vol or clm) in the directory.");
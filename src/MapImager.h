@@ -2,32 +2,149 @@
 
 #include "OP2Utility.h"
 #include "RenderManager.h"
+#include "ThreadPool.h"
+#include "TilesetCache.h"
+#include "ResourceCatalog.h"
 #include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <map>
+#include <tuple>
+#include <utility>
+#include <functional>
+#include <cstdint>
 
 struct RenderSettings
 {
 	ImageFormat imageFormat = ImageFormat::PNG;
-	unsigned scaleFactor = 4;
+	std::vector<unsigned> scaleFactors = { 4 };
+	ScaleFilter scaleFilter = ScaleFilter::CatmullRom;
+	PngPreset pngPreset = PngPreset::Balanced;
+	unsigned threadCount = 0; // 0 uses all hardware threads
+	unsigned jobCount = 1; // Maps rendered concurrently. 0 uses all hardware threads.
+	unsigned streamTileRows = 0; // 0 renders the whole map in memory before saving
+	unsigned pipelineDepth = 0; // Maps queued between pipeline stages. 0 completes each map before starting the next.
+	uint64_t maxMemory = 0; // Bytes of predicted memory concurrent renders may use. 0 does not limit memory.
 	std::string destDirectory = "MapRenders";
+	std::string tilesetCacheDirectory; // Empty keeps scaled tilesets in memory only
+	std::string archiveIndexFilename; // Empty reads the index of every archive each run
 	bool overwrite = false;
 	bool quiet = false;
 	bool helpRequested = false;
+	bool benchmarkRequested = false;
 	bool accessArchives = true;
+	bool indexed = false; // Renders 8 bit indexed color with a palette merged from the map's tilesets
+	unsigned pyramidTileSize = 0; // Writes a zoom/x/y pyramid of tiles this many pixels across instead of whole renders. 0 is off.
+	bool linkDuplicateTiles = false; // Stores identical tile pyramid tiles once, hard linking the duplicates
+	bool incremental = false; // Skips maps whose inputs are unchanged since their renders were saved
 };
 
+// Renders maps found in a directory. Reuse one MapImager for every map of a batch
+// so its framebuffer and thread pool are shared between renders.
+// The tileset cache may also be shared between MapImagers of different directories.
+// FreeImage must be initialized (see FreeImageInitializer) before rendering.
+// A MapImager renders one map at a time. Use one MapImager per thread to render maps concurrently.
 class MapImager
 {
 public:
-	MapImager(std::string directory) : resourceManager(directory) {};
-	void ImageMap(const std::string& renderFilename, const std::string& filename, const RenderSettings& renderSettings);
-	std::string FormatRenderFilename(const std::string& filename, const RenderSettings& renderSettings);
+	using ScaledTilesets = std::vector<std::shared_ptr<const ScaledTileset>>;
+
+	// A map read along with its tilesets scaled to each requested scale factor, ready to render
+	struct PreparedMap
+	{
+		std::string filename;
+		Map map;
+		std::vector<std::pair<unsigned, ScaledTilesets>> scaledTilesets; // Largest scale factor first
+	};
+
+	// renderManager holds a render awaiting encoding. It is null if the render was already saved, as when streaming bands.
+	struct MapRender
+	{
+		std::string renderFilename;
+		std::unique_ptr<RenderManager> renderManager;
+	};
+
+	// MapImagers of the same directory share its ResourceCatalog
+	MapImager(std::string directory, std::shared_ptr<TilesetCache> tilesetCache = std::make_shared<TilesetCache>()) :
+		resourceCatalog(ResourceCatalog::Open(directory)), tilesetCache(tilesetCache) {};
+	// Renders the map once for each requested scale factor and returns the filenames of the saved renders
+	std::vector<std::string> ImageMap(const std::string& filename, const RenderSettings& renderSettings);
+	std::string FormatRenderFilename(const std::string& filename, const RenderSettings& renderSettings, unsigned scaleFactor);
 	std::string GetImageFormatExtension(ImageFormat imageFormat);
 
+	// The stages of ImageMap, allowing stages of consecutive maps to overlap (see RenderPipeline).
+	// PrepareMap and RenderPreparedMap use separate resources, so they may run concurrently on different threads.
+	PreparedMap PrepareMap(const std::string& filename, const RenderSettings& renderSettings);
+	std::vector<MapRender> RenderPreparedMap(PreparedMap& preparedMap, const RenderSettings& renderSettings);
+
+	struct RenderEstimate
+	{
+		uint64_t renderCost; // Relative cost, the map's tile count
+		uint64_t peakMemory; // Bytes
+	};
+
+	// Predicts the cost and peak memory of rendering a map, reading only the map header
+	RenderEstimate EstimateRender(const std::string& filename, const RenderSettings& renderSettings);
+
+	// Hash of the map and tileset contents the map's renders are drawn from. Throws if any of them is missing.
+	uint64_t HashRenderInputs(const std::string& filename, const RenderSettings& renderSettings);
+
+	// Frees the framebuffer kept between renders, so memory is only held while rendering
+	void ReleaseFramebuffer();
+
 private:
-	ResourceManager resourceManager;
+	// Bits per pixel of scaled tilesets and of full color renders
+	static constexpr unsigned TilesetBpp = 24;
+
+	// Generous estimate of the tiles held by the tilesets of a map, used to predict memory use
+	static constexpr uint64_t EstimatedTilesetTileCount = 2048;
+
+	// Scale factor of the most detailed tile pyramid zoom level, drawing tiles at full size
+	static constexpr unsigned PyramidMaxScaleFactor = 32;
+
+	static std::mutex reservedFilenamesMutex;
+	static std::set<std::string> reservedFilenames;
+
+	std::shared_ptr<ResourceCatalog> resourceCatalog;
+	std::shared_ptr<TilesetCache> tilesetCache;
+	std::unique_ptr<ThreadPool> renderThreadPool;
+	std::unique_ptr<FreeImageBmp> framebuffer;
+
+	// FNV-1a hash, CRC-32, width and height of a tile's contents
+	using TileKey = std::tuple<uint64_t, uint32_t, unsigned, unsigned>;
+
+	struct PyramidTileStore
+	{
+		std::map<TileKey, std::string> tilesByPixels; // First saved tile of each distinct image, when linking duplicate tiles
+		uint64_t tileCount = 0;
+		uint64_t storedTileCount = 0; // Tiles saved rather than linked to an identical tile
+	};
 
-	void SetRenderTiles(Map& map, RenderManager& mapImager);
-	void LoadTilesets(Map& map, RenderManager& mapImager, bool accessArchives);
+	std::string RenderPyramid(PreparedMap& preparedMap, const RenderSettings& renderSettings);
+	void RenderPyramidLevel(const std::string& levelDirectory, Map& map, const ScaledTilesets& tilesets, unsigned scaleFactor,
+		const RenderSettings& renderSettings, PyramidTileStore& tileStore);
+	static TileKey HashMapTiles(Map& map, unsigned firstTileColumn, unsigned endTileColumn, unsigned firstTileRow, unsigned endTileRow);
+	static void LinkPyramidTile(const std::string& sourceFilename, const std::string& tileFilename);
+	std::string FormatPyramidDirectory(const std::string& filename, const RenderSettings& renderSettings);
+	static std::vector<unsigned> GetPyramidScaleFactors(uint64_t mapTileWidth, uint64_t mapTileHeight, unsigned pyramidTileSize);
+	void RunOnRenderThreads(std::size_t taskCount, unsigned threadCount, const std::function<void(std::size_t task)>& task);
+	void RenderMap(const std::string& renderFilename, Map& map, const ScaledTilesets& tilesets, unsigned scaleFactor, const RenderSettings& renderSettings);
+	void SetRenderTiles(Map& map, RenderManager& renderManager, unsigned firstTileRow, unsigned endTileRow, unsigned threadCount);
+	void SetRenderTileRows(Map& map, RenderManager& renderManager, unsigned firstTileRow, unsigned endTileRow);
+	void SetRenderTileRegion(Map& map, RenderManager& renderManager, unsigned firstTileColumn, unsigned endTileColumn,
+		unsigned firstTileRow, unsigned endTileRow);
+	ThreadPool& GetRenderThreadPool(unsigned threadCount);
+	FreeImageBmp AcquireFramebuffer(unsigned width, unsigned height, unsigned bpp);
+	ScaledTilesets LoadTilesets(Map& map, unsigned scaleFactor, unsigned bpp, ScaleFilter scaleFilter, bool accessArchives);
+	ScaledTilesets DownscaleTilesets(const ScaledTilesets& tilesets, unsigned factor);
+	ScaledTilesets GetScaledTilesets(Map& map, unsigned scaleFactor, unsigned previousScaleFactor, const ScaledTilesets& previousTilesets, const RenderSettings& renderSettings);
+	ScaledTilesets GetRenderTilesets(Map& map, unsigned scaleFactor, const ScaledTilesets& tilesets, const RenderSettings& renderSettings);
+	std::vector<TilesetCacheKey> GetTilesetCacheKeys(Map& map, unsigned scaleFactor, unsigned bpp, ScaleFilter scaleFilter);
+	static unsigned GetRenderBpp(const RenderSettings& renderSettings);
+	static std::vector<unsigned> GetRenderScaleFactors(const RenderSettings& renderSettings);
+	static uint64_t EstimatePeakMemory(uint64_t mapTileWidth, uint64_t mapTileHeight, const RenderSettings& renderSettings);
 	std::string CreateUniqueFilename(const std::string& filename);
 	Map ReadMap(const std::string& filename, bool accessArchives);
 };
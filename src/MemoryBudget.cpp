@@ -0,0 +1,31 @@
+#include "MemoryBudget.h"
+
+MemoryBudget::MemoryBudget(uint64_t budget) : budget(budget), reserved(0) { }
+
+void MemoryBudget::Reserve(uint64_t byteCount)
+{
+	if (budget == 0) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(mutex);
+	released.wait(lock, [this, byteCount] {
+		return reserved == 0 || (reserved <= budget && byteCount <= budget - reserved);
+	});
+
+	reserved += byteCount;
+}
+
+void MemoryBudget::Release(uint64_t byteCount)
+{
+	if (budget == 0) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		reserved -= byteCount;
+	}
+
+	released.notify_all();
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+// Limits the total predicted memory of concurrent renders. Thread safe.
+class MemoryBudget
+{
+public:
+	// A budget of 0 bytes does not limit memory
+	explicit MemoryBudget(uint64_t budget);
+
+	MemoryBudget(const MemoryBudget&) = delete;
+	MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+	// Blocks until byteCount fits within the remaining budget. A reservation larger than the
+	// whole budget is admitted once nothing else is reserved, so every render eventually runs.
+	void Reserve(uint64_t byteCount);
+	void Release(uint64_t byteCount);
+
+private:
+	const uint64_t budget;
+	uint64_t reserved;
+	std::mutex mutex;
+	std::condition_variable released;
+};
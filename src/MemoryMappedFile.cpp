@@ -0,0 +1,117 @@
+#include "MemoryMappedFile.h"
+#include <filesystem>
+#include <stdexcept>
+#include <limits>
+#include <cstdint>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MemoryMappedFile::MemoryMappedFile(const std::string& filename)
+{
+	HANDLE fileHandle = CreateFileW(std::filesystem::path(filename).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Unable to open " + filename);
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize) ||
+		static_cast<uint64_t>(fileSize.QuadPart) > std::numeric_limits<std::size_t>::max())
+	{
+		CloseHandle(fileHandle);
+		throw std::runtime_error("Unable to map " + filename + " into memory");
+	}
+
+	size = static_cast<std::size_t>(fileSize.QuadPart);
+
+	// A mapping of an empty file cannot be created
+	if (size == 0) {
+		CloseHandle(fileHandle);
+		return;
+	}
+
+	// The mapping keeps the file open, so the file handle may be closed
+	mappingHandle = CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(fileHandle);
+
+	if (mappingHandle == nullptr) {
+		throw std::runtime_error("Unable to map " + filename + " into memory");
+	}
+
+	data = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+
+	if (data == nullptr) {
+		CloseHandle(mappingHandle);
+		throw std::runtime_error("Unable to map " + filename + " into memory");
+	}
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+	if (data != nullptr) {
+		UnmapViewOfFile(data);
+		CloseHandle(mappingHandle);
+	}
+}
+
+#else
+
+MemoryMappedFile::MemoryMappedFile(const std::string& filename)
+{
+	const int fileDescriptor = open(filename.c_str(), O_RDONLY);
+
+	if (fileDescriptor == -1) {
+		throw std::runtime_error("Unable to open " + filename);
+	}
+
+	struct stat fileStatus;
+	if (fstat(fileDescriptor, &fileStatus) != 0 ||
+		static_cast<uint64_t>(fileStatus.st_size) > std::numeric_limits<std::size_t>::max())
+	{
+		close(fileDescriptor);
+		throw std::runtime_error("Unable to map " + filename + " into memory");
+	}
+
+	size = static_cast<std::size_t>(fileStatus.st_size);
+
+	// mmap rejects a length of 0
+	if (size == 0) {
+		close(fileDescriptor);
+		return;
+	}
+
+	// The mapping keeps the file open, so the descriptor may be closed
+	void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+	close(fileDescriptor);
+
+	if (mapping == MAP_FAILED) {
+		throw std::runtime_error("Unable to map " + filename + " into memory");
+	}
+
+	data = static_cast<const char*>(mapping);
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+	if (data != nullptr) {
+		munmap(const_cast<char*>(data), size);
+	}
+}
+
+#endif
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+// Maps a whole file read only into memory. Pages are loaded by the operating system as they are read,
+// and are shared with the file cache, so reading the mapping does not copy the file.
+class MemoryMappedFile
+{
+public:
+	// Throws if the file cannot be opened or mapped
+	explicit MemoryMappedFile(const std::string& filename);
+	~MemoryMappedFile();
+
+	MemoryMappedFile(const MemoryMappedFile&) = delete;
+	MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+
+	// nullptr for an empty file
+	const char* Data() const { return data; }
+	std::size_t Size() const { return size; }
+
+private:
+	const char* data = nullptr;
+	std::size_t size = 0;
+#ifdef _WIN32
+	void* mappingHandle = nullptr;
+#endif
+};
@@ -0,0 +1,493 @@
+#include "PngWriter.h"
+#include <stdexcept>
+#include <limits>
+#include <cstdlib>
+#include <algorithm>
+#include <future>
+
+const std::size_t PngWriter::ChunkTargetSize = 1 << 18;
+const std::size_t PngWriter::ChunksPerBatch = 64;
+const std::size_t PngWriter::DeflateWindowSize = 1 << 15;
+
+PngWriter::PngWriter(const std::string& filename, unsigned width, unsigned height, unsigned bpp,
+	const std::vector<RGBQUAD>& palette, int compressionLevel, Filter filter, int strategy, ThreadPool* threadPool) :
+	filename(filename),
+	width(width),
+	height(height),
+	bytesPerPixel(bpp / 8),
+	rowByteCount(static_cast<std::size_t>(width) * (bpp / 8)),
+	filteredRowSize(rowByteCount + 1),
+	chunkRowCount(static_cast<unsigned>(std::max<std::size_t>(1, ChunkTargetSize / filteredRowSize))),
+	compressionLevel(compressionLevel),
+	filter(filter),
+	strategy(strategy),
+	threadPool(threadPool),
+	scanlinesWritten(0),
+	file(filename, std::ios::out | std::ios::binary | std::ios::trunc),
+	output(file),
+	previousRow(rowByteCount, 0),
+	adler(adler32(0L, Z_NULL, 0)),
+	zlibHeaderWritten(false)
+{
+	Initialize(bpp, palette);
+}
+
+PngWriter::PngWriter(std::ostream& output, unsigned width, unsigned height, unsigned bpp,
+	const std::vector<RGBQUAD>& palette, int compressionLevel, Filter filter, int strategy, ThreadPool* threadPool) :
+	filename("memory"),
+	width(width),
+	height(height),
+	bytesPerPixel(bpp / 8),
+	rowByteCount(static_cast<std::size_t>(width) * (bpp / 8)),
+	filteredRowSize(rowByteCount + 1),
+	chunkRowCount(static_cast<unsigned>(std::max<std::size_t>(1, ChunkTargetSize / filteredRowSize))),
+	compressionLevel(compressionLevel),
+	filter(filter),
+	strategy(strategy),
+	threadPool(threadPool),
+	scanlinesWritten(0),
+	output(output),
+	previousRow(rowByteCount, 0),
+	adler(adler32(0L, Z_NULL, 0)),
+	zlibHeaderWritten(false)
+{
+	Initialize(bpp, palette);
+}
+
+PngWriter::Compression PngWriter::GetPresetCompression(PngPreset preset)
+{
+	switch (preset)
+	{
+	case PngPreset::Fast:
+		// Sub filtering costs a fraction of adaptive filtering, and suits rows of repeated tiles
+		return Compression{ 1, Filter::Sub, Z_DEFAULT_STRATEGY };
+	case PngPreset::Small:
+		// Filtered data is mostly small values, which Z_FILTERED codes better than string matching alone
+		return Compression{ 9, Filter::Adaptive, Z_FILTERED };
+	default:
+		return Compression{ Z_DEFAULT_COMPRESSION, Filter::Adaptive, Z_DEFAULT_STRATEGY };
+	}
+}
+
+void PngWriter::Initialize(unsigned bpp, const std::vector<RGBQUAD>& palette)
+{
+	if (bpp != 8 && bpp != 24 && bpp != 32) {
+		throw std::runtime_error("PNG writer only supports 8, 24 and 32 bits per pixel");
+	}
+	if (bpp == 8 && (palette.empty() || palette.size() > 256)) {
+		throw std::runtime_error("An 8 bit PNG file requires a palette of 1 to 256 colors");
+	}
+	const unsigned maxDimension = static_cast<unsigned>(std::numeric_limits<int32_t>::max());
+	if (width > maxDimension || height > maxDimension) {
+		throw std::runtime_error("Render is too large to save as a PNG file: " + filename);
+	}
+	if (compressionLevel != Z_DEFAULT_COMPRESSION && (compressionLevel < 0 || compressionLevel > 9)) {
+		throw std::runtime_error("PNG compression level must be from 0 to 9");
+	}
+
+	CheckFileState();
+	WriteHeader(palette);
+}
+
+void PngWriter::WriteHeader(const std::vector<RGBQUAD>& palette)
+{
+	const BYTE signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	output.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+	std::vector<BYTE> header;
+	AppendUint32BigEndian(header, width);
+	AppendUint32BigEndian(header, height);
+	header.push_back(8); // Bit depth
+	header.push_back(bytesPerPixel == 4 ? 6 : bytesPerPixel == 3 ? 2 : 3); // Color type, RGBA, RGB or indexed
+	header.push_back(0); // Compression method, deflate
+	header.push_back(0); // Filter method, adaptive filtering with 5 basic filter types
+	header.push_back(0); // Interlace method, none
+
+	WriteChunk("IHDR", header.data(), header.size());
+
+	if (bytesPerPixel == 1)
+	{
+		std::vector<BYTE> paletteChunk;
+		for (const auto& color : palette) {
+			paletteChunk.push_back(color.rgbRed);
+			paletteChunk.push_back(color.rgbGreen);
+			paletteChunk.push_back(color.rgbBlue);
+		}
+
+		WriteChunk("PLTE", paletteChunk.data(), paletteChunk.size());
+	}
+}
+
+void PngWriter::WriteScanlines(const BYTE* topScanline, std::ptrdiff_t pitch, unsigned scanlineCount)
+{
+	if (scanlineCount > height - scanlinesWritten) {
+		throw std::runtime_error("More scanlines written than the height of " + filename);
+	}
+
+	const std::size_t batchRowCount = static_cast<std::size_t>(chunkRowCount) * ChunksPerBatch;
+
+	// Batches end on chunk boundaries, so scanlines are held until a whole chunk may be compressed
+	const BYTE* scanline = topScanline;
+	while (scanlineCount > 0)
+	{
+		const std::size_t pendingRowCount = pendingRows.size() / filteredRowSize;
+		const unsigned batchScanlineCount = static_cast<unsigned>(std::min<std::size_t>(scanlineCount, batchRowCount - pendingRowCount));
+
+		FilterScanlines(scanline, pitch, batchScanlineCount);
+		CompressPendingRows(false);
+
+		scanline += pitch * static_cast<std::ptrdiff_t>(batchScanlineCount);
+		scanlineCount -= batchScanlineCount;
+		scanlinesWritten += batchScanlineCount;
+	}
+}
+
+void PngWriter::Finish()
+{
+	if (scanlinesWritten != height) {
+		throw std::runtime_error("Render was not completely written to " + filename);
+	}
+
+	CompressPendingRows(true);
+	WriteChunk("IEND", nullptr, 0);
+
+	if (file.is_open()) {
+		file.close();
+	}
+	CheckFileState();
+}
+
+// Filters groups of scanlines concurrently. Each group converts the scanline above it again,
+// since filters compare each scanline with the unfiltered scanline above.
+void PngWriter::FilterScanlines(const BYTE* topScanline, std::ptrdiff_t pitch, unsigned scanlineCount)
+{
+	const std::size_t firstRowOffset = pendingRows.size();
+	pendingRows.resize(firstRowOffset + scanlineCount * filteredRowSize);
+
+	const std::size_t taskCount = (scanlineCount + chunkRowCount - 1) / chunkRowCount;
+
+	RunTasks(taskCount, [&](std::size_t task) {
+		const unsigned firstScanline = static_cast<unsigned>(task * chunkRowCount);
+		const unsigned endScanline = std::min(firstScanline + chunkRowCount, scanlineCount);
+
+		std::vector<BYTE> row(rowByteCount);
+		std::vector<BYTE> rowAbove(previousRow);
+		if (firstScanline > 0) {
+			ConvertScanline(topScanline + pitch * static_cast<std::ptrdiff_t>(firstScanline - 1), width, bytesPerPixel, rowAbove.data());
+		}
+
+		for (unsigned i = firstScanline; i < endScanline; ++i)
+		{
+			ConvertScanline(topScanline + pitch * static_cast<std::ptrdiff_t>(i), width, bytesPerPixel, row.data());
+			FilterRow(filter, row.data(), rowAbove.data(), rowByteCount, bytesPerPixel,
+				pendingRows.data() + firstRowOffset + i * filteredRowSize);
+			row.swap(rowAbove);
+		}
+	});
+
+	if (scanlineCount > 0) {
+		ConvertScanline(topScanline + pitch * static_cast<std::ptrdiff_t>(scanlineCount - 1), width, bytesPerPixel, previousRow.data());
+	}
+}
+
+// Compresses each complete chunk of pending scanlines, and when finishing, the final partial chunk.
+// Chunks are written as IDAT chunks in order, forming one zlib stream.
+void PngWriter::CompressPendingRows(bool finish)
+{
+	const std::size_t chunkSize = chunkRowCount * filteredRowSize;
+
+	std::size_t chunkCount = pendingRows.size() / chunkSize;
+	if (finish) {
+		// The final chunk may be partial or empty, and ends the deflate stream
+		chunkCount = pendingRows.size() / chunkSize + (pendingRows.size() % chunkSize != 0 || pendingRows.empty() ? 1 : 0);
+	}
+	if (chunkCount == 0) {
+		return;
+	}
+
+	std::vector<std::vector<BYTE>> compressedChunks(chunkCount);
+	std::vector<uLong> chunkAdlers(chunkCount);
+
+	RunTasks(chunkCount, [&](std::size_t chunk) {
+		const BYTE* data = pendingRows.data() + chunk * chunkSize;
+		const std::size_t size = std::min(chunkSize, pendingRows.size() - chunk * chunkSize);
+
+		// The window of a chunk is the end of the chunk before it
+		const BYTE* dictionaryData = dictionary.data();
+		std::size_t dictionarySize = dictionary.size();
+		if (chunk > 0) {
+			dictionarySize = std::min(chunkSize, DeflateWindowSize);
+			dictionaryData = data - dictionarySize;
+		}
+
+		compressedChunks[chunk] = DeflateChunk(data, size, dictionaryData, dictionarySize, compressionLevel,
+			strategy, finish && chunk == chunkCount - 1);
+		chunkAdlers[chunk] = adler32(adler32(0L, Z_NULL, 0), data, static_cast<uInt>(size));
+	});
+
+	for (std::size_t chunk = 0; chunk < chunkCount; ++chunk)
+	{
+		const std::size_t size = std::min(chunkSize, pendingRows.size() - chunk * chunkSize);
+		adler = adler32_combine(adler, chunkAdlers[chunk], static_cast<z_off_t>(size));
+
+		std::vector<BYTE>& idatData = compressedChunks[chunk];
+
+		if (!zlibHeaderWritten)
+		{
+			// Deflate with a 32 KB window. The level hint matches what zlib writes for the compression level.
+			const BYTE levelHint = compressionLevel == Z_DEFAULT_COMPRESSION || compressionLevel == 6 ? 2 :
+				compressionLevel < 2 ? 0 : compressionLevel < 6 ? 1 : 3;
+			const BYTE compressionMethod = 0x78;
+			BYTE flags = static_cast<BYTE>(levelHint << 6);
+			flags = static_cast<BYTE>(flags + 31 - ((compressionMethod * 256 + flags) % 31));
+
+			idatData.insert(idatData.begin(), { compressionMethod, flags });
+			zlibHeaderWritten = true;
+		}
+
+		if (finish && chunk == chunkCount - 1) {
+			AppendUint32BigEndian(idatData, static_cast<uint32_t>(adler));
+		}
+
+		WriteChunk("IDAT", idatData.data(), idatData.size());
+	}
+
+	// Keep the last 32 KB of compressed scanlines as the window of the next chunk
+	const std::size_t compressedSize = std::min(chunkCount * chunkSize, pendingRows.size());
+	if (compressedSize >= DeflateWindowSize) {
+		dictionary.assign(pendingRows.begin() + (compressedSize - DeflateWindowSize), pendingRows.begin() + compressedSize);
+	}
+	else {
+		dictionary.insert(dictionary.end(), pendingRows.begin(), pendingRows.begin() + compressedSize);
+		if (dictionary.size() > DeflateWindowSize) {
+			dictionary.erase(dictionary.begin(), dictionary.end() - DeflateWindowSize);
+		}
+	}
+
+	pendingRows.erase(pendingRows.begin(), pendingRows.begin() + compressedSize);
+}
+
+void PngWriter::RunTasks(std::size_t taskCount, const std::function<void(std::size_t task)>& task)
+{
+	if (threadPool == nullptr || threadPool->ThreadCount() <= 1 || taskCount <= 1)
+	{
+		for (std::size_t i = 0; i < taskCount; ++i) {
+			task(i);
+		}
+		return;
+	}
+
+	std::vector<std::future<void>> results;
+	for (std::size_t i = 0; i < taskCount; ++i) {
+		results.push_back(threadPool->Enqueue([&task, i] { task(i); }));
+	}
+
+	// Wait for every task before rethrowing, since tasks refer to this writer's buffers
+	std::exception_ptr taskException;
+	for (auto& result : results)
+	{
+		try {
+			result.get();
+		}
+		catch (...) {
+			if (!taskException) {
+				taskException = std::current_exception();
+			}
+		}
+	}
+
+	if (taskException) {
+		std::rethrow_exception(taskException);
+	}
+}
+
+std::vector<BYTE> PngWriter::DeflateChunk(const BYTE* data, std::size_t size, const BYTE* dictionaryData, std::size_t dictionarySize,
+	int compressionLevel, int strategy, bool finalChunk)
+{
+	z_stream zStream{};
+
+	// Negative window bits write raw deflate data, without a zlib header or checksum
+	if (deflateInit2(&zStream, compressionLevel, Z_DEFLATED, -15, 8, strategy) != Z_OK) {
+		throw std::runtime_error("Unable to initialize PNG compression");
+	}
+
+	if (dictionarySize > 0 &&
+		deflateSetDictionary(&zStream, dictionaryData, static_cast<uInt>(dictionarySize)) != Z_OK)
+	{
+		deflateEnd(&zStream);
+		throw std::runtime_error("Unable to initialize PNG compression");
+	}
+
+	// A sync flush marker follows the compressed data of chunks other than the last
+	std::vector<BYTE> compressedData(deflateBound(&zStream, static_cast<uLong>(size)) + 16);
+
+	zStream.next_in = const_cast<Bytef*>(data);
+	zStream.avail_in = static_cast<uInt>(size);
+	zStream.next_out = compressedData.data();
+	zStream.avail_out = static_cast<uInt>(compressedData.size());
+
+	const int flush = finalChunk ? Z_FINISH : Z_SYNC_FLUSH;
+	while (true)
+	{
+		const int result = deflate(&zStream, flush);
+		if (result == Z_STREAM_ERROR) {
+			deflateEnd(&zStream);
+			throw std::runtime_error("Error compressing PNG data");
+		}
+
+		// Compression is complete once deflate leaves output space unused
+		if (zStream.avail_out != 0 && (!finalChunk || result == Z_STREAM_END)) {
+			break;
+		}
+
+		const std::size_t compressedSize = compressedData.size() - zStream.avail_out;
+		compressedData.resize(compressedData.size() * 2);
+		zStream.next_out = compressedData.data() + compressedSize;
+		zStream.avail_out = static_cast<uInt>(compressedData.size() - compressedSize);
+	}
+
+	compressedData.resize(compressedData.size() - zStream.avail_out);
+	deflateEnd(&zStream);
+
+	return compressedData;
+}
+
+void PngWriter::WriteChunk(const char* chunkType, const BYTE* data, std::size_t size)
+{
+	std::vector<BYTE> chunkHeader;
+	AppendUint32BigEndian(chunkHeader, static_cast<uint32_t>(size));
+	chunkHeader.insert(chunkHeader.end(), chunkType, chunkType + 4);
+
+	// CRC covers the chunk type and data, but not the length
+	uLong crc = crc32(0L, chunkHeader.data() + 4, 4);
+	if (size > 0) {
+		crc = crc32(crc, data, static_cast<uInt>(size));
+	}
+	std::vector<BYTE> chunkFooter;
+	AppendUint32BigEndian(chunkFooter, static_cast<uint32_t>(crc));
+
+	output.write(reinterpret_cast<const char*>(chunkHeader.data()), chunkHeader.size());
+	if (size > 0) {
+		output.write(reinterpret_cast<const char*>(data), size);
+	}
+	output.write(reinterpret_cast<const char*>(chunkFooter.data()), chunkFooter.size());
+	CheckFileState();
+}
+
+void PngWriter::CheckFileState()
+{
+	if (!output) {
+		throw std::runtime_error("Error writing render to file: " + filename);
+	}
+}
+
+void PngWriter::ConvertScanline(const BYTE* scanline, unsigned width, unsigned bytesPerPixel, BYTE* pngRow)
+{
+	if (bytesPerPixel == 1) {
+		std::copy(scanline, scanline + width, pngRow);
+		return;
+	}
+
+	for (unsigned x = 0; x < width; ++x)
+	{
+		pngRow[0] = scanline[FI_RGBA_RED];
+		pngRow[1] = scanline[FI_RGBA_GREEN];
+		pngRow[2] = scanline[FI_RGBA_BLUE];
+		if (bytesPerPixel == 4) {
+			pngRow[3] = scanline[FI_RGBA_ALPHA];
+		}
+
+		scanline += bytesPerPixel;
+		pngRow += bytesPerPixel;
+	}
+}
+
+void PngWriter::FilterRow(Filter filter, const BYTE* row, const BYTE* previousRow, std::size_t rowByteCount,
+	unsigned bytesPerPixel, BYTE* filteredRow)
+{
+	if (filter != Filter::Adaptive) {
+		filteredRow[0] = static_cast<BYTE>(filter);
+		ApplyFilter(filter, row, previousRow, rowByteCount, bytesPerPixel, filteredRow + 1);
+		return;
+	}
+
+	// Same heuristic as libpng: pick the filter with the smallest sum of output bytes taken as signed values
+	std::vector<BYTE> candidate(rowByteCount);
+	uint64_t bestSum = std::numeric_limits<uint64_t>::max();
+
+	for (const auto candidateFilter : { Filter::None, Filter::Sub, Filter::Up, Filter::Average, Filter::Paeth })
+	{
+		ApplyFilter(candidateFilter, row, previousRow, rowByteCount, bytesPerPixel, candidate.data());
+		const uint64_t sum = SumOfAbsoluteValues(candidate.data(), candidate.size());
+
+		if (sum < bestSum) {
+			bestSum = sum;
+			filteredRow[0] = static_cast<BYTE>(candidateFilter);
+			std::copy(candidate.begin(), candidate.end(), filteredRow + 1);
+		}
+	}
+}
+
+void PngWriter::ApplyFilter(Filter filter, const BYTE* row, const BYTE* previousRow, std::size_t rowByteCount,
+	unsigned bytesPerPixel, BYTE* filteredData)
+{
+	for (std::size_t i = 0; i < rowByteCount; ++i)
+	{
+		const BYTE left = i >= bytesPerPixel ? row[i - bytesPerPixel] : 0;
+		const BYTE above = previousRow[i];
+		const BYTE upperLeft = i >= bytesPerPixel ? previousRow[i - bytesPerPixel] : 0;
+
+		switch (filter)
+		{
+		case Filter::Sub:
+			filteredData[i] = static_cast<BYTE>(row[i] - left);
+			break;
+		case Filter::Up:
+			filteredData[i] = static_cast<BYTE>(row[i] - above);
+			break;
+		case Filter::Average:
+			filteredData[i] = static_cast<BYTE>(row[i] - ((left + above) / 2));
+			break;
+		case Filter::Paeth:
+			filteredData[i] = static_cast<BYTE>(row[i] - PaethPredictor(left, above, upperLeft));
+			break;
+		default:
+			filteredData[i] = row[i];
+			break;
+		}
+	}
+}
+
+uint64_t PngWriter::SumOfAbsoluteValues(const BYTE* filteredData, std::size_t size)
+{
+	uint64_t sum = 0;
+	for (std::size_t i = 0; i < size; ++i) {
+		sum += static_cast<uint64_t>(std::abs(static_cast<int>(static_cast<signed char>(filteredData[i]))));
+	}
+
+	return sum;
+}
+
+BYTE PngWriter::PaethPredictor(BYTE left, BYTE above, BYTE upperLeft)
+{
+	const int estimate = left + above - upperLeft;
+	const int leftDistance = std::abs(estimate - left);
+	const int aboveDistance = std::abs(estimate - above);
+	const int upperLeftDistance = std::abs(estimate - upperLeft);
+
+	if (leftDistance <= aboveDistance && leftDistance <= upperLeftDistance) {
+		return left;
+	}
+	if (aboveDistance <= upperLeftDistance) {
+		return above;
+	}
+	return upperLeft;
+}
+
+void PngWriter::AppendUint32BigEndian(std::vector<BYTE>& buffer, uint32_t value)
+{
+	buffer.push_back(static_cast<BYTE>(value >> 24));
+	buffer.push_back(static_cast<BYTE>(value >> 16));
+	buffer.push_back(static_cast<BYTE>(value >> 8));
+	buffer.push_back(static_cast<BYTE>(value));
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "ScanlineWriter.h"
+#include "ThreadPool.h"
+#include <zlib.h>
+#include <string>
+#include <fstream>
+#include <ostream>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+// Trades PNG encoding speed against file size. Fast suits previews, Small suits archived renders.
+enum class PngPreset
+{
+	Fast,
+	Balanced,
+	Small,
+};
+
+// Streams an 8 bit per channel RGB or RGBA PNG file, or an 8 bit indexed color PNG file,
+// compressing scanlines as they arrive.
+// Like pigz, scanlines are filtered and deflated in chunks of a fixed number of rows, which may be compressed
+// concurrently on a ThreadPool. Each chunk is primed with the 32 KB of data before it, and chunks are joined
+// into a single zlib stream. Chunk size depends only on the image width, so files are byte identical for
+// any thread count.
+class PngWriter : public ScanlineWriter
+{
+public:
+	// Scanline filter applied before compression. Adaptive picks the best filter for each scanline.
+	enum class Filter
+	{
+		None = 0,
+		Sub = 1,
+		Up = 2,
+		Average = 3,
+		Paeth = 4,
+		Adaptive,
+	};
+
+	struct Compression
+	{
+		int compressionLevel;
+		Filter filter;
+		int strategy;
+	};
+
+	// Compression settings of a preset, chosen from the PNG preset table of the Benchmark switch (see DeveloperReadMe.txt)
+	static Compression GetPresetCompression(PngPreset preset);
+
+	// compressionLevel is a zlib level, 0 (none) to 9 (smallest), and strategy a zlib strategy such as Z_RLE.
+	// An 8 bit file requires a palette of up to 256 colors. threadPool may be nullptr to compress on the calling thread.
+	PngWriter(const std::string& filename, unsigned width, unsigned height, unsigned bpp,
+		const std::vector<RGBQUAD>& palette = {}, int compressionLevel = Z_DEFAULT_COMPRESSION, Filter filter = Filter::Adaptive,
+		int strategy = Z_DEFAULT_STRATEGY, ThreadPool* threadPool = nullptr);
+
+	// Writes the PNG file to a stream, such as to encode an image in memory
+	PngWriter(std::ostream& output, unsigned width, unsigned height, unsigned bpp,
+		const std::vector<RGBQUAD>& palette = {}, int compressionLevel = Z_DEFAULT_COMPRESSION, Filter filter = Filter::Adaptive,
+		int strategy = Z_DEFAULT_STRATEGY, ThreadPool* threadPool = nullptr);
+
+	PngWriter(const PngWriter&) = delete;
+	PngWriter& operator=(const PngWriter&) = delete;
+
+	void WriteScanlines(const BYTE* topScanline, std::ptrdiff_t pitch, unsigned scanlineCount) override;
+	void Finish() override;
+
+	// Converts a FreeImage scanline into PNG byte order (RGB or RGBA). Indexed scanlines are copied unchanged.
+	static void ConvertScanline(const BYTE* scanline, unsigned width, unsigned bytesPerPixel, BYTE* pngRow);
+
+	// Writes the filter type byte followed by the filtered row into filteredRow (rowByteCount + 1 bytes).
+	// previousRow is the unfiltered row above, all zeros for the first row of the image.
+	static void FilterRow(Filter filter, const BYTE* row, const BYTE* previousRow, std::size_t rowByteCount,
+		unsigned bytesPerPixel, BYTE* filteredRow);
+
+private:
+	// Uncompressed bytes of filtered scanlines per chunk
+	static const std::size_t ChunkTargetSize;
+	// Chunks filtered and compressed at once, limiting memory held for scanlines awaiting compression
+	static const std::size_t ChunksPerBatch;
+	static const std::size_t DeflateWindowSize;
+
+	const std::string filename;
+	const unsigned width;
+	const unsigned height;
+	const unsigned bytesPerPixel;
+	const std::size_t rowByteCount;
+	const std::size_t filteredRowSize;
+	const unsigned chunkRowCount;
+	const int compressionLevel;
+	const Filter filter;
+	const int strategy;
+	ThreadPool* const threadPool;
+	unsigned scanlinesWritten;
+	std::ofstream file;
+	std::ostream& output;
+	std::vector<BYTE> previousRow; // Unfiltered, in PNG byte order
+	std::vector<BYTE> pendingRows; // Filtered scanlines not yet compressed
+	std::vector<BYTE> dictionary; // Up to 32 KB of filtered scanlines preceding pendingRows
+	uLong adler;
+	bool zlibHeaderWritten;
+
+	void Initialize(unsigned bpp, const std::vector<RGBQUAD>& palette);
+	void WriteHeader(const std::vector<RGBQUAD>& palette);
+	void FilterScanlines(const BYTE* topScanline, std::ptrdiff_t pitch, unsigned scanlineCount);
+	void CompressPendingRows(bool finish);
+	void RunTasks(std::size_t taskCount, const std::function<void(std::size_t task)>& task);
+	void WriteChunk(const char* chunkType, const BYTE* data, std::size_t size);
+	void CheckFileState();
+
+	// Raw deflate of one chunk, ending on a byte boundary unless it is the final chunk
+	static std::vector<BYTE> DeflateChunk(const BYTE* data, std::size_t size, const BYTE* dictionaryData, std::size_t dictionarySize,
+		int compressionLevel, int strategy, bool finalChunk);
+	static void ApplyFilter(Filter filter, const BYTE* row, const BYTE* previousRow, std::size_t rowByteCount,
+		unsigned bytesPerPixel, BYTE* filteredData);
+	static uint64_t SumOfAbsoluteValues(const BYTE* filteredData, std::size_t size);
+	static BYTE PaethPredictor(BYTE left, BYTE above, BYTE upperLeft);
+	static void AppendUint32BigEndian(std::vector<BYTE>& buffer, uint32_t value);
+};
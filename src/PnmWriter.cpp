@@ -0,0 +1,123 @@
+#include "PnmWriter.h"
+#include <stdexcept>
+#include <string>
+
+PnmWriter::PnmWriter(const std::string& filename, Format format, unsigned width, unsigned height, unsigned bpp,
+	const std::vector<RGBQUAD>& palette) :
+	filename(filename),
+	width(width),
+	height(height),
+	bytesPerPixel(bpp / 8),
+	channelCount(format == Format::PAM && bpp == 32 ? 4 : 3),
+	palette(palette),
+	scanlinesWritten(0),
+	file(filename, std::ios::out | std::ios::binary | std::ios::trunc),
+	output(file),
+	row(static_cast<std::size_t>(width) * channelCount)
+{
+	Initialize(format, bpp);
+}
+
+PnmWriter::PnmWriter(std::ostream& output, Format format, unsigned width, unsigned height, unsigned bpp,
+	const std::vector<RGBQUAD>& palette) :
+	filename("memory"),
+	width(width),
+	height(height),
+	bytesPerPixel(bpp / 8),
+	channelCount(format == Format::PAM && bpp == 32 ? 4 : 3),
+	palette(palette),
+	scanlinesWritten(0),
+	output(output),
+	row(static_cast<std::size_t>(width) * channelCount)
+{
+	Initialize(format, bpp);
+}
+
+void PnmWriter::Initialize(Format format, unsigned bpp)
+{
+	if (bpp != 8 && bpp != 24 && bpp != 32) {
+		throw std::runtime_error("Netpbm writer only supports 8, 24 and 32 bits per pixel");
+	}
+	if (bpp == 8 && (palette.empty() || palette.size() > 256)) {
+		throw std::runtime_error("An 8 bit render requires a palette of 1 to 256 colors");
+	}
+
+	CheckFileState();
+	WriteHeader(format);
+}
+
+void PnmWriter::WriteHeader(Format format)
+{
+	std::string header;
+
+	if (format == Format::PPM) {
+		header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+	}
+	else {
+		header = "P7\nWIDTH " + std::to_string(width) + "\nHEIGHT " + std::to_string(height) +
+			"\nDEPTH " + std::to_string(channelCount) + "\nMAXVAL 255\nTUPLTYPE " +
+			(channelCount == 4 ? "RGB_ALPHA" : "RGB") + "\nENDHDR\n";
+	}
+
+	output.write(header.data(), header.size());
+	CheckFileState();
+}
+
+void PnmWriter::WriteScanlines(const BYTE* topScanline, std::ptrdiff_t pitch, unsigned scanlineCount)
+{
+	if (scanlineCount > height - scanlinesWritten) {
+		throw std::runtime_error("More scanlines written than the height of " + filename);
+	}
+
+	const BYTE* scanline = topScanline;
+	for (unsigned i = 0; i < scanlineCount; ++i)
+	{
+		const BYTE* source = scanline;
+		BYTE* dest = row.data();
+		for (unsigned x = 0; x < width; ++x)
+		{
+			if (bytesPerPixel == 1) {
+				const RGBQUAD& color = palette[*source < palette.size() ? *source : 0];
+				dest[0] = color.rgbRed;
+				dest[1] = color.rgbGreen;
+				dest[2] = color.rgbBlue;
+			}
+			else {
+				dest[0] = source[FI_RGBA_RED];
+				dest[1] = source[FI_RGBA_GREEN];
+				dest[2] = source[FI_RGBA_BLUE];
+				if (channelCount == 4) {
+					dest[3] = source[FI_RGBA_ALPHA];
+				}
+			}
+
+			source += bytesPerPixel;
+			dest += channelCount;
+		}
+
+		output.write(reinterpret_cast<const char*>(row.data()), row.size());
+		scanline += pitch;
+	}
+
+	CheckFileState();
+	scanlinesWritten += scanlineCount;
+}
+
+void PnmWriter::Finish()
+{
+	if (scanlinesWritten != height) {
+		throw std::runtime_error("Render was not completely written to " + filename);
+	}
+
+	if (file.is_open()) {
+		file.close();
+	}
+	CheckFileState();
+}
+
+void PnmWriter::CheckFileState()
+{
+	if (!output) {
+		throw std::runtime_error("Error writing render to file: " + filename);
+	}
+}
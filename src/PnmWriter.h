@@ -0,0 +1,49 @@
+#pragma once
+
+#include "ScanlineWriter.h"
+#include <string>
+#include <fstream>
+#include <ostream>
+#include <vector>
+
+// Streams uncompressed pixels as a binary Netpbm file, for tools that only need raw pixels.
+// PPM stores RGB. PAM stores RGB, or RGB_ALPHA for 32 bit renders. 8 bit renders are expanded through their palette.
+class PnmWriter : public ScanlineWriter
+{
+public:
+	enum class Format
+	{
+		PPM,
+		PAM,
+	};
+
+	// An 8 bit render requires a palette of up to 256 colors. PPM files drop the alpha of 32 bit renders.
+	PnmWriter(const std::string& filename, Format format, unsigned width, unsigned height, unsigned bpp,
+		const std::vector<RGBQUAD>& palette = {});
+
+	// Writes the Netpbm file to a stream, such as to encode an image in memory
+	PnmWriter(std::ostream& output, Format format, unsigned width, unsigned height, unsigned bpp,
+		const std::vector<RGBQUAD>& palette = {});
+
+	PnmWriter(const PnmWriter&) = delete;
+	PnmWriter& operator=(const PnmWriter&) = delete;
+
+	void WriteScanlines(const BYTE* topScanline, std::ptrdiff_t pitch, unsigned scanlineCount) override;
+	void Finish() override;
+
+private:
+	const std::string filename;
+	const unsigned width;
+	const unsigned height;
+	const unsigned bytesPerPixel;
+	const unsigned channelCount; // Channels stored per pixel
+	const std::vector<RGBQUAD> palette;
+	unsigned scanlinesWritten;
+	std::ofstream file;
+	std::ostream& output;
+	std::vector<BYTE> row;
+
+	void Initialize(Format format, unsigned bpp);
+	void WriteHeader(Format format);
+	void CheckFileState();
+};
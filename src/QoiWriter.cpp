@@ -0,0 +1,191 @@
+#include "QoiWriter.h"
+#include <stdexcept>
+
+QoiWriter::QoiWriter(const std::string& filename, unsigned width, unsigned height, unsigned bpp, const std::vector<RGBQUAD>& palette) :
+	filename(filename),
+	width(width),
+	height(height),
+	bytesPerPixel(bpp / 8),
+	palette(palette),
+	scanlinesWritten(0),
+	file(filename, std::ios::out | std::ios::binary | std::ios::trunc),
+	output(file),
+	seenPixels(),
+	previousPixel{ 0, 0, 0, 255 },
+	runLength(0)
+{
+	Initialize(bpp);
+}
+
+QoiWriter::QoiWriter(std::ostream& output, unsigned width, unsigned height, unsigned bpp, const std::vector<RGBQUAD>& palette) :
+	filename("memory"),
+	width(width),
+	height(height),
+	bytesPerPixel(bpp / 8),
+	palette(palette),
+	scanlinesWritten(0),
+	output(output),
+	seenPixels(),
+	previousPixel{ 0, 0, 0, 255 },
+	runLength(0)
+{
+	Initialize(bpp);
+}
+
+void QoiWriter::Initialize(unsigned bpp)
+{
+	if (bpp != 8 && bpp != 24 && bpp != 32) {
+		throw std::runtime_error("QOI writer only supports 8, 24 and 32 bits per pixel");
+	}
+	if (bpp == 8 && (palette.empty() || palette.size() > 256)) {
+		throw std::runtime_error("An 8 bit render requires a palette of 1 to 256 colors");
+	}
+
+	CheckFileState();
+	WriteHeader();
+}
+
+void QoiWriter::WriteHeader()
+{
+	std::vector<BYTE> header = { 'q', 'o', 'i', 'f' };
+
+	// QOI fields are big endian
+	for (const uint32_t value : { static_cast<uint32_t>(width), static_cast<uint32_t>(height) }) {
+		for (int shift = 24; shift >= 0; shift -= 8) {
+			header.push_back(static_cast<BYTE>(value >> shift));
+		}
+	}
+
+	header.push_back(bytesPerPixel == 4 ? 4 : 3); // Channels
+	header.push_back(0); // Colorspace, sRGB with linear alpha
+
+	output.write(reinterpret_cast<const char*>(header.data()), header.size());
+	CheckFileState();
+}
+
+void QoiWriter::WriteScanlines(const BYTE* topScanline, std::ptrdiff_t pitch, unsigned scanlineCount)
+{
+	if (scanlineCount > height - scanlinesWritten) {
+		throw std::runtime_error("More scanlines written than the height of " + filename);
+	}
+
+	const BYTE* scanline = topScanline;
+	for (unsigned i = 0; i < scanlineCount; ++i)
+	{
+		const BYTE* source = scanline;
+		for (unsigned x = 0; x < width; ++x)
+		{
+			if (bytesPerPixel == 1) {
+				const RGBQUAD& color = palette[*source < palette.size() ? *source : 0];
+				EncodePixel(Pixel{ color.rgbRed, color.rgbGreen, color.rgbBlue, 255 });
+			}
+			else {
+				EncodePixel(Pixel{ source[FI_RGBA_RED], source[FI_RGBA_GREEN], source[FI_RGBA_BLUE],
+					static_cast<BYTE>(bytesPerPixel == 4 ? source[FI_RGBA_ALPHA] : 255) });
+			}
+
+			source += bytesPerPixel;
+		}
+
+		scanline += pitch;
+	}
+
+	output.write(reinterpret_cast<const char*>(encodedScanlines.data()), encodedScanlines.size());
+	encodedScanlines.clear();
+	CheckFileState();
+
+	scanlinesWritten += scanlineCount;
+}
+
+void QoiWriter::Finish()
+{
+	if (scanlinesWritten != height) {
+		throw std::runtime_error("Render was not completely written to " + filename);
+	}
+
+	EncodeRun();
+
+	// End marker
+	encodedScanlines.insert(encodedScanlines.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+	output.write(reinterpret_cast<const char*>(encodedScanlines.data()), encodedScanlines.size());
+	encodedScanlines.clear();
+
+	if (file.is_open()) {
+		file.close();
+	}
+	CheckFileState();
+}
+
+void QoiWriter::EncodePixel(const Pixel& pixel)
+{
+	if (pixel == previousPixel)
+	{
+		// A run holds at most 62 pixels
+		if (++runLength == 62) {
+			EncodeRun();
+		}
+		return;
+	}
+
+	EncodeRun();
+
+	const unsigned hash = HashPixel(pixel);
+	if (seenPixels[hash] == pixel) {
+		encodedScanlines.push_back(static_cast<BYTE>(hash)); // QOI_OP_INDEX
+		previousPixel = pixel;
+		return;
+	}
+	seenPixels[hash] = pixel;
+
+	if (pixel[3] != previousPixel[3]) {
+		encodedScanlines.insert(encodedScanlines.end(), { 0xFF, pixel[0], pixel[1], pixel[2], pixel[3] }); // QOI_OP_RGBA
+		previousPixel = pixel;
+		return;
+	}
+
+	// Channel differences wrap around, as in the QOI specification
+	const int redDifference = static_cast<signed char>(pixel[0] - previousPixel[0]);
+	const int greenDifference = static_cast<signed char>(pixel[1] - previousPixel[1]);
+	const int blueDifference = static_cast<signed char>(pixel[2] - previousPixel[2]);
+	const int redGreenDifference = redDifference - greenDifference;
+	const int blueGreenDifference = blueDifference - greenDifference;
+
+	if (redDifference >= -2 && redDifference <= 1 && greenDifference >= -2 && greenDifference <= 1 &&
+		blueDifference >= -2 && blueDifference <= 1)
+	{
+		// QOI_OP_DIFF
+		encodedScanlines.push_back(static_cast<BYTE>(0x40 | (redDifference + 2) << 4 | (greenDifference + 2) << 2 | (blueDifference + 2)));
+	}
+	else if (greenDifference >= -32 && greenDifference <= 31 && redGreenDifference >= -8 && redGreenDifference <= 7 &&
+		blueGreenDifference >= -8 && blueGreenDifference <= 7)
+	{
+		// QOI_OP_LUMA
+		encodedScanlines.push_back(static_cast<BYTE>(0x80 | (greenDifference + 32)));
+		encodedScanlines.push_back(static_cast<BYTE>((redGreenDifference + 8) << 4 | (blueGreenDifference + 8)));
+	}
+	else {
+		encodedScanlines.insert(encodedScanlines.end(), { 0xFE, pixel[0], pixel[1], pixel[2] }); // QOI_OP_RGB
+	}
+
+	previousPixel = pixel;
+}
+
+void QoiWriter::EncodeRun()
+{
+	if (runLength > 0) {
+		encodedScanlines.push_back(static_cast<BYTE>(0xC0 | (runLength - 1))); // QOI_OP_RUN
+		runLength = 0;
+	}
+}
+
+unsigned QoiWriter::HashPixel(const Pixel& pixel)
+{
+	return (pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64;
+}
+
+void QoiWriter::CheckFileState()
+{
+	if (!output) {
+		throw std::runtime_error("Error writing render to file: " + filename);
+	}
+}
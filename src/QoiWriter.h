@@ -0,0 +1,54 @@
+#pragma once
+
+#include "ScanlineWriter.h"
+#include <string>
+#include <fstream>
+#include <ostream>
+#include <vector>
+#include <array>
+#include <cstdint>
+
+// Streams a QOI (Quite OK Image) file, a lossless format encoding many times faster than PNG.
+// 24 bit renders are stored as RGB and 32 bit renders as RGBA. 8 bit renders are expanded through their palette.
+class QoiWriter : public ScanlineWriter
+{
+public:
+	// An 8 bit render requires a palette of up to 256 colors
+	QoiWriter(const std::string& filename, unsigned width, unsigned height, unsigned bpp,
+		const std::vector<RGBQUAD>& palette = {});
+
+	// Writes the QOI file to a stream, such as to encode an image in memory
+	QoiWriter(std::ostream& output, unsigned width, unsigned height, unsigned bpp,
+		const std::vector<RGBQUAD>& palette = {});
+
+	QoiWriter(const QoiWriter&) = delete;
+	QoiWriter& operator=(const QoiWriter&) = delete;
+
+	void WriteScanlines(const BYTE* topScanline, std::ptrdiff_t pitch, unsigned scanlineCount) override;
+	void Finish() override;
+
+private:
+	// Red, green, blue, alpha
+	using Pixel = std::array<BYTE, 4>;
+
+	const std::string filename;
+	const unsigned width;
+	const unsigned height;
+	const unsigned bytesPerPixel;
+	const std::vector<RGBQUAD> palette;
+	unsigned scanlinesWritten;
+	std::ofstream file;
+	std::ostream& output;
+	std::array<Pixel, 64> seenPixels; // Recently seen pixels, indexed by a hash of their color
+	Pixel previousPixel;
+	unsigned runLength;
+	std::vector<BYTE> encodedScanlines;
+
+	void Initialize(unsigned bpp);
+	void WriteHeader();
+	void EncodePixel(const Pixel& pixel);
+	void EncodeRun();
+	void CheckFileState();
+
+	static unsigned HashPixel(const Pixel& pixel);
+};
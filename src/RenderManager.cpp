@@ -1,9 +1,22 @@
 #include "RenderManager.h"
+#include "TilesetBmpDecoder.h"
+#include "BmpWriter.h"
+#include "PngWriter.h"
+#include "QoiWriter.h"
+#include "PnmWriter.h"
+#include "ContentHash.h"
 #include <stdexcept>
 #include <limits>
+#include <mutex>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
 
 using namespace std;
 
+// FreeImage reports messages on the thread that called it, so each render may collect its own messages
+thread_local std::ostream* RenderManager::threadMessageStream = nullptr;
+
 void RenderManager::Initialize()
 {
 	FreeImage_Initialise();
@@ -16,18 +29,55 @@ void RenderManager::Deinitialize()
 }
 
 void RenderManager::FreeImageErrorHandler(FREE_IMAGE_FORMAT fif, const char *message) {
-	printf("\n*** ");
+	// Format the whole message first so messages from concurrent renders are never interleaved
+	string formattedMessage = "\n*** ";
 	if (fif != FIF_UNKNOWN) {
-		printf("%s Format\n", FreeImage_GetFormatFromFIF(fif));
+		formattedMessage += string(FreeImage_GetFormatFromFIF(fif)) + " Format\n";
+	}
+	formattedMessage += string(message) + " ***\n\n";
+
+	if (threadMessageStream != nullptr) {
+		*threadMessageStream << formattedMessage;
+		return;
 	}
-	printf("%s", message);
-	printf(" ***\n\n");
+
+	static std::mutex printMutex;
+	std::lock_guard<std::mutex> lock(printMutex);
+	printf("%s", formattedMessage.c_str());
+}
+
+void RenderManager::SetThreadMessageStream(std::ostream* messageStream)
+{
+	threadMessageStream = messageStream;
 }
 
 RenderManager::RenderManager(unsigned mapTileWidth, unsigned mapTileHeight, unsigned bpp, unsigned scaleFactor) : 
+	RenderManager(mapTileWidth, mapTileHeight, bpp, scaleFactor, mapTileHeight) { }
+
+RenderManager::RenderManager(unsigned mapTileWidth, unsigned mapTileHeight, unsigned bpp, unsigned scaleFactor, unsigned bandTileHeight) :
+	RenderManager(mapTileWidth, mapTileHeight, scaleFactor,
+		FreeImageBmp(mapTileWidth * scaleFactor, bandTileHeight * scaleFactor, bpp)) { }
+
+RenderManager::RenderManager(unsigned mapTileWidth, unsigned mapTileHeight, unsigned scaleFactor, FreeImageBmp&& renderTarget) :
+	mapTileWidth(mapTileWidth),
+	mapTileHeight(mapTileHeight),
 	scaleFactor(scaleFactor),
-	freeImageBmpDest(mapTileWidth * scaleFactor, mapTileHeight * scaleFactor, bpp) 
+	bytesPerPixel(renderTarget.Bpp() / 8),
+	copyTile(TileBlitter::SelectCopyTile(scaleFactor, renderTarget.Bpp() / 8)),
+	freeImageBmpDest(std::move(renderTarget)),
+	bandFirstTileRow(0)
 {
+	const unsigned bpp = freeImageBmpDest.Bpp();
+	if (bpp != 8 && bpp != 24 && bpp != 32) {
+		throw std::runtime_error("Only 8 (indexed), 24 and 32 bits per pixel renders are supported");
+	}
+
+	if (freeImageBmpDest.Width() != mapTileWidth * scaleFactor ||
+		freeImageBmpDest.Height() < scaleFactor || freeImageBmpDest.Height() % scaleFactor != 0)
+	{
+		throw std::runtime_error("Render target dimensions do not match the map width and a whole number of tile rows");
+	}
+
 	// maxTileDimension is the maximum width or height of a map in tiles
 	const auto maxTileDimension = std::numeric_limits<unsigned int>::max() / scaleFactor;
 	if ((mapTileWidth > maxTileDimension) || (mapTileHeight > maxTileDimension)) {
@@ -35,13 +85,63 @@ RenderManager::RenderManager(unsigned mapTileWidth, unsigned mapTileHeight, unsi
 	}
 }
 
-void RenderManager::AddTileset(BYTE* tilesetMemoryPointer, std::size_t tilesetSize)
+void RenderManager::AddTileset(const BYTE* tilesetMemoryPointer, std::size_t tilesetSize)
+{
+	AddTileset(CreateScaledTileset(tilesetMemoryPointer, tilesetSize, scaleFactor, Bpp()));
+}
+
+void RenderManager::AddTileset(std::string filename, ImageFormat imageFormat)
+{
+	FreeImageBmp freeImageBmp(GetFIImageFormat(imageFormat), filename.c_str());
+
+	AddTileset(ScaleTileset(freeImageBmp, scaleFactor, Bpp()));
+}
+
+void RenderManager::AddTileset(std::shared_ptr<const ScaledTileset> scaledTileset)
+{
+	if (scaledTileset->bitmap.Width() != scaleFactor || scaledTileset->bitmap.Bpp() != Bpp() ||
+		scaledTileset->bitmap.Height() != scaledTileset->tileCount * scaleFactor)
+	{
+		throw std::runtime_error("Scaled tileset does not match the scale factor and pixel format of the render");
+	}
+
+	// Indexed tilesets share one palette, which becomes the palette of the render
+	if (Bpp() == 8)
+	{
+		const std::size_t paletteSize = 256 * sizeof(RGBQUAD);
+
+		if (tilesets.empty()) {
+			std::memcpy(freeImageBmpDest.Palette(), scaledTileset->bitmap.Palette(), paletteSize);
+		}
+		else if (std::memcmp(freeImageBmpDest.Palette(), scaledTileset->bitmap.Palette(), paletteSize) != 0) {
+			throw std::runtime_error("Indexed tilesets of a render must share one palette");
+		}
+	}
+
+	tilesets.push_back(std::move(scaledTileset));
+}
+
+std::shared_ptr<const ScaledTileset> RenderManager::CreateScaledTileset(const BYTE* tilesetMemoryPointer, std::size_t tilesetSize, unsigned scaleFactor, unsigned bpp, ScaleFilter scaleFilter)
 {
+	auto tilesetBmp = TilesetBmpDecoder::Decode(tilesetMemoryPointer, tilesetSize, bpp);
+
+	if (tilesetBmp) {
+		// At full size the decoded tileset is already laid out as the render expects
+		if (scaleFactor == tilesetBmp->Width()) {
+			const unsigned tilesetTileCount = tilesetBmp->Height() / scaleFactor;
+			return std::make_shared<const ScaledTileset>(ScaledTileset{ std::move(*tilesetBmp), tilesetTileCount });
+		}
+
+		return ScaleTileset(*tilesetBmp, scaleFactor, bpp, scaleFilter);
+	}
+
+	// Unusual tileset layouts are decoded by FreeImage
 	if (tilesetSize > std::numeric_limits<DWORD>::max()) {
 		throw std::runtime_error("Tileset size is too large");
 	}
 
-	FIMEMORY* fiMemory = FreeImage_OpenMemory(tilesetMemoryPointer, static_cast<DWORD>(tilesetSize));
+	// FreeImage only reads memory it is given, so read only memory such as a file mapping may be decoded in place
+	FIMEMORY* fiMemory = FreeImage_OpenMemory(const_cast<BYTE*>(tilesetMemoryPointer), static_cast<DWORD>(tilesetSize));
 
 	try
 	{
@@ -50,24 +150,18 @@ void RenderManager::AddTileset(BYTE* tilesetMemoryPointer, std::size_t tilesetSi
 		}
 
 		FreeImageBmp freeImageBmp(FREE_IMAGE_FORMAT::FIF_BMP, fiMemory);
-		AddScaledTileset(freeImageBmp);
+		auto scaledTileset = ScaleTileset(freeImageBmp, scaleFactor, bpp, scaleFilter);
+
+		FreeImage_CloseMemory(fiMemory);
+		return scaledTileset;
 	}
-	catch (const std::exception& e){
+	catch (...) {
 		FreeImage_CloseMemory(fiMemory);
-		throw e;
+		throw;
 	}
-
-	FreeImage_CloseMemory(fiMemory);
-}
-
-void RenderManager::AddTileset(std::string filename, ImageFormat imageFormat)
-{
-	FreeImageBmp freeImageBmp(GetFIImageFormat(imageFormat), filename.c_str());
-
-	AddScaledTileset(freeImageBmp);
 }
 
-void RenderManager::AddScaledTileset(const FreeImageBmp& fiTilesetBmp)
+std::shared_ptr<const ScaledTileset> RenderManager::ScaleTileset(const FreeImageBmp& fiTilesetBmp, unsigned scaleFactor, unsigned bpp, ScaleFilter scaleFilter)
 {
 	const unsigned nonScaledTileLength = 32;
 
@@ -77,7 +171,7 @@ void RenderManager::AddScaledTileset(const FreeImageBmp& fiTilesetBmp)
 			std::to_string(nonScaledTileLength) + " pixels (1 tile)");
 	}
 	// Height must be a multiple of the tile size
-	if ((fiTilesetBmp.Width() % nonScaledTileLength) != 0) {
+	if ((fiTilesetBmp.Height() % nonScaledTileLength) != 0) {
 		throw std::runtime_error("Source tileset height must be an integer multiple of " + 
 			std::to_string(nonScaledTileLength) + " pixels (tile size)");
 	}
@@ -95,47 +189,269 @@ void RenderManager::AddScaledTileset(const FreeImageBmp& fiTilesetBmp)
 	const unsigned tilesetScaledWidth = scaleFactor;
 	const unsigned tilesetScaledHeight = tilesetTileCount * scaleFactor;
 
-	tilesetBmps.push_back(fiTilesetBmp.Rescale(tilesetScaledWidth, tilesetScaledHeight));
-	tilesetTileCounts.push_back(tilesetTileCount);
+	// Match the render pixel format so tiles may be copied directly into the render
+	if (scaleFilter == ScaleFilter::FastBox && nonScaledTileLength % scaleFactor == 0) {
+		// Convert first, since the native box filter averages full color pixels
+		const unsigned factor = nonScaledTileLength / scaleFactor;
+		FreeImageBmp scaledTilesetBmp = fiTilesetBmp.Bpp() == bpp ?
+			ImageFilter::BoxDownsample(fiTilesetBmp, factor) :
+			ImageFilter::BoxDownsample(fiTilesetBmp.ConvertToBpp(bpp), factor);
+
+		return std::make_shared<const ScaledTileset>(ScaledTileset{ std::move(scaledTilesetBmp), tilesetTileCount });
+	}
+
+	FreeImageBmp scaledTilesetBmp = fiTilesetBmp.Rescale(tilesetScaledWidth, tilesetScaledHeight, ImageFilter::GetFIFilter(scaleFilter));
+	if (scaledTilesetBmp.Bpp() != bpp) {
+		scaledTilesetBmp = scaledTilesetBmp.ConvertToBpp(bpp);
+	}
+
+	return std::make_shared<const ScaledTileset>(ScaledTileset{ std::move(scaledTilesetBmp), tilesetTileCount });
+}
+
+unsigned RenderManager::ScaleFactor() const
+{
+	return scaleFactor;
+}
+
+unsigned RenderManager::Bpp() const
+{
+	return freeImageBmpDest.Bpp();
 }
 
 void RenderManager::PasteTile(std::size_t tilesetIndex, std::size_t tileIndex, int xPos, int yPos)
 {
-	if (tilesetIndex >= tilesetTileCounts.size()) {
+	if (tilesetIndex >= tilesets.size()) {
 		throw std::runtime_error("Requested tileset has not been loaded into RenderManager");
 	}
 
 	// Check tile index values are in range
-	if (tileIndex >= tilesetTileCounts[tilesetIndex]) {
+	if (tileIndex >= tilesets[tilesetIndex]->tileCount) {
 		throw std::runtime_error("Tile index out of range");
 	}
 
-	// Image dimension pre-checked, so no overflow if tileIndex is in range
-	const unsigned int tilesetYPixelPos = static_cast<unsigned int>(tileIndex * scaleFactor);
-
-	FreeImageBmp tileBmp = tilesetBmps[tilesetIndex].CreateView(
-		0, tilesetYPixelPos + scaleFactor, scaleFactor, tilesetYPixelPos
-	);
-
 	const int leftPixelPos = xPos * scaleFactor;
-	const int topPixelPos = yPos * scaleFactor;
-	const int alpha = 256;
+	const int topPixelPos = (yPos - static_cast<int>(bandFirstTileRow)) * static_cast<int>(scaleFactor);
 
-	try {
-		tileBmp.Paste(freeImageBmpDest, leftPixelPos, topPixelPos, alpha);
-	} catch(...) {
+	// Destination dimensions are a multiple of scaleFactor, so the whole tile fits if its corner does
+	if (xPos < 0 || topPixelPos < 0 ||
+		static_cast<unsigned>(leftPixelPos) >= freeImageBmpDest.Width() ||
+		static_cast<unsigned>(topPixelPos) >= freeImageBmpDest.Height())
+	{
 		throw std::runtime_error(
 			"Unable to paste a tile index " + std::to_string(tileIndex) +
 			" from tileset index " + std::to_string(tilesetIndex) + " onto new render"
 		);
 	}
+
+	const FreeImageBmp& tilesetBmp = tilesets[tilesetIndex]->bitmap;
+
+	// Image dimension pre-checked, so no overflow if tileIndex is in range
+	const unsigned int tilesetYPixelPos = static_cast<unsigned int>(tileIndex * scaleFactor);
+
+	// Scanlines are stored bottom-up, so copy starting from the bottom row of the tile
+	const BYTE* source = tilesetBmp.ScanLine(tilesetBmp.Height() - tilesetYPixelPos - scaleFactor);
+	BYTE* dest = freeImageBmpDest.ScanLine(freeImageBmpDest.Height() - topPixelPos - scaleFactor) +
+		leftPixelPos * bytesPerPixel;
+
+	copyTile(dest, freeImageBmpDest.Pitch(), source, tilesetBmp.Pitch(), scaleFactor, bytesPerPixel);
 }
 
-void RenderManager::SaveMapImage(const std::string& destFilename, ImageFormat imageFormat)
+void RenderManager::SaveMapImage(const std::string& destFilename, ImageFormat imageFormat, PngPreset pngPreset, ThreadPool* threadPool)
 {
+	// PNG, QOI and Netpbm are encoded natively. PngWriter may spread compression across threads.
+	if (IsNativeFormat(imageFormat)) {
+		WriteImage(*CreateNativeWriter(destFilename, imageFormat, Width(), Height(), pngPreset, threadPool));
+		return;
+	}
+
+	// JPEG has no indexed color, so indexed renders are expanded first
+	if (imageFormat == ImageFormat::JPG && Bpp() == 8) {
+		freeImageBmpDest.ConvertToBpp(24).Save(destFilename, GetFIImageFormat(imageFormat), GetFISaveFlag(imageFormat));
+		return;
+	}
+
 	freeImageBmpDest.Save(destFilename, GetFIImageFormat(imageFormat), GetFISaveFlag(imageFormat));
 }
 
+std::vector<BYTE> RenderManager::EncodeMapImage(ImageFormat imageFormat, PngPreset pngPreset, ThreadPool* threadPool) const
+{
+	if (IsNativeFormat(imageFormat))
+	{
+		std::ostringstream encodedImage(std::ios::out | std::ios::binary);
+		WriteImage(*CreateNativeWriter(encodedImage, imageFormat, Width(), Height(), pngPreset, threadPool));
+
+		const std::string encodedString = encodedImage.str();
+		return std::vector<BYTE>(encodedString.begin(), encodedString.end());
+	}
+
+	if (imageFormat == ImageFormat::JPG && Bpp() == 8) {
+		return freeImageBmpDest.ConvertToBpp(24).SaveToMemory(GetFIImageFormat(imageFormat), GetFISaveFlag(imageFormat));
+	}
+
+	return freeImageBmpDest.SaveToMemory(GetFIImageFormat(imageFormat), GetFISaveFlag(imageFormat));
+}
+
+std::unique_ptr<ScanlineWriter> RenderManager::CreateScanlineWriter(const std::string& destFilename, ImageFormat imageFormat,
+	PngPreset pngPreset, ThreadPool* threadPool) const
+{
+	if (imageFormat == ImageFormat::BMP) {
+		return std::make_unique<BmpWriter>(destFilename, Width(), Height(), Bpp(), GetPalette());
+	}
+	if (IsNativeFormat(imageFormat)) {
+		return CreateNativeWriter(destFilename, imageFormat, Width(), Height(), pngPreset, threadPool);
+	}
+
+	throw std::runtime_error("Rendering in bands does not support the JPG image format");
+}
+
+void RenderManager::SaveBandRegion(const std::string& destFilename, ImageFormat imageFormat, PngPreset pngPreset,
+	unsigned left, unsigned top, unsigned width, unsigned height) const
+{
+	const unsigned bandHeight = freeImageBmpDest.Height();
+
+	if (width == 0 || height == 0 || left + width > freeImageBmpDest.Width() || top + height > bandHeight) {
+		throw std::runtime_error("Region is outside of the render band");
+	}
+
+	if (imageFormat == ImageFormat::JPG)
+	{
+		// FreeImage views use top-down coordinates
+		FreeImageBmp region = freeImageBmpDest.CreateView(left, top, left + width, top + height);
+		if (Bpp() == 8) {
+			region = region.ConvertToBpp(24);
+		}
+
+		region.Save(destFilename, GetFIImageFormat(imageFormat), GetFISaveFlag(imageFormat));
+		return;
+	}
+
+	std::unique_ptr<ScanlineWriter> scanlineWriter;
+	if (imageFormat == ImageFormat::BMP) {
+		scanlineWriter = std::make_unique<BmpWriter>(destFilename, width, height, Bpp(), GetPalette());
+	}
+	else {
+		scanlineWriter = CreateNativeWriter(destFilename, imageFormat, width, height, pngPreset, nullptr);
+	}
+
+	scanlineWriter->WriteScanlines(freeImageBmpDest.ScanLine(bandHeight - 1 - top) + static_cast<std::size_t>(left) * bytesPerPixel,
+		-static_cast<std::ptrdiff_t>(freeImageBmpDest.Pitch()), height);
+	scanlineWriter->Finish();
+}
+
+std::pair<uint64_t, uint32_t> RenderManager::HashBandRegion(unsigned left, unsigned top, unsigned width, unsigned height) const
+{
+	const unsigned bandHeight = freeImageBmpDest.Height();
+
+	if (left + width > freeImageBmpDest.Width() || top + height > bandHeight) {
+		throw std::runtime_error("Region is outside of the render band");
+	}
+
+	const std::size_t rowByteCount = static_cast<std::size_t>(width) * bytesPerPixel;
+	uint64_t contentHash = ContentHash::OffsetBasis;
+	uLong crc = crc32(0L, Z_NULL, 0);
+
+	// Indexed pixels only match if their palettes match too
+	if (Bpp() == 8) {
+		const std::size_t paletteSize = 256 * sizeof(RGBQUAD);
+		contentHash = ContentHash::Compute(freeImageBmpDest.Palette(), paletteSize, contentHash);
+		crc = crc32(crc, reinterpret_cast<const Bytef*>(freeImageBmpDest.Palette()), static_cast<uInt>(paletteSize));
+	}
+
+	for (unsigned y = top; y < top + height; ++y)
+	{
+		const BYTE* row = freeImageBmpDest.ScanLine(bandHeight - 1 - y) + static_cast<std::size_t>(left) * bytesPerPixel;
+		contentHash = ContentHash::Compute(row, rowByteCount, contentHash);
+		crc = crc32(crc, row, static_cast<uInt>(rowByteCount));
+	}
+
+	return { contentHash, static_cast<uint32_t>(crc) };
+}
+
+unsigned RenderManager::Width() const
+{
+	return mapTileWidth * scaleFactor;
+}
+
+unsigned RenderManager::Height() const
+{
+	return mapTileHeight * scaleFactor;
+}
+
+bool RenderManager::IsNativeFormat(ImageFormat imageFormat)
+{
+	return imageFormat == ImageFormat::PNG || imageFormat == ImageFormat::QOI ||
+		imageFormat == ImageFormat::PPM || imageFormat == ImageFormat::PAM;
+}
+
+// destination is a filename or an output stream
+template<typename Destination>
+std::unique_ptr<ScanlineWriter> RenderManager::CreateNativeWriter(Destination& destination, ImageFormat imageFormat,
+	unsigned width, unsigned height, PngPreset pngPreset, ThreadPool* threadPool) const
+{
+	const unsigned bpp = freeImageBmpDest.Bpp();
+
+	switch (imageFormat)
+	{
+	case ImageFormat::PNG:
+	{
+		const auto compression = PngWriter::GetPresetCompression(pngPreset);
+		return std::make_unique<PngWriter>(destination, width, height, bpp, GetPalette(),
+			compression.compressionLevel, compression.filter, compression.strategy, threadPool);
+	}
+	case ImageFormat::QOI:
+		return std::make_unique<QoiWriter>(destination, width, height, bpp, GetPalette());
+	case ImageFormat::PPM:
+		return std::make_unique<PnmWriter>(destination, PnmWriter::Format::PPM, width, height, bpp, GetPalette());
+	case ImageFormat::PAM:
+		return std::make_unique<PnmWriter>(destination, PnmWriter::Format::PAM, width, height, bpp, GetPalette());
+	default:
+		throw std::runtime_error("Image format is not encoded natively");
+	}
+}
+
+void RenderManager::SetBand(unsigned firstTileRow)
+{
+	if (firstTileRow >= mapTileHeight) {
+		throw std::runtime_error("Band starting at tile row " + std::to_string(firstTileRow) + " is outside of the map");
+	}
+
+	bandFirstTileRow = firstTileRow;
+}
+
+void RenderManager::WriteBand(ScanlineWriter& scanlineWriter, unsigned tileRowCount) const
+{
+	const unsigned scanlineCount = tileRowCount * scaleFactor;
+	const unsigned bandHeight = freeImageBmpDest.Height();
+
+	if (scanlineCount > bandHeight) {
+		throw std::runtime_error("Requested more tile rows than are held in the render band");
+	}
+
+	// Walk the bottom-up bitmap from its top scanline downwards
+	scanlineWriter.WriteScanlines(freeImageBmpDest.ScanLine(bandHeight - 1),
+		-static_cast<std::ptrdiff_t>(freeImageBmpDest.Pitch()), scanlineCount);
+}
+
+// Writes the whole render, which must not be rendered in bands
+void RenderManager::WriteImage(ScanlineWriter& scanlineWriter) const
+{
+	if (freeImageBmpDest.Height() != mapTileHeight * scaleFactor) {
+		throw std::runtime_error("Render in bands must be saved one band at a time");
+	}
+
+	WriteBand(scanlineWriter, mapTileHeight);
+	scanlineWriter.Finish();
+}
+
+std::vector<RGBQUAD> RenderManager::GetPalette() const
+{
+	if (freeImageBmpDest.Bpp() != 8) {
+		return {};
+	}
+
+	return std::vector<RGBQUAD>(freeImageBmpDest.Palette(), freeImageBmpDest.Palette() + 256);
+}
+
 FREE_IMAGE_FORMAT RenderManager::GetFIImageFormat(ImageFormat imageFormat) const
 {
 	switch (imageFormat)
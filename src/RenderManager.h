@@ -1,16 +1,36 @@
 #pragma once
 
 #include "FreeImageBmp.h"
+#include "TileBlitter.h"
+#include "ScanlineWriter.h"
+#include "PngWriter.h"
+#include "ImageFilter.h"
+#include "ThreadPool.h"
 #include "../FreeImage/Dist/x32/FreeImage.h"
 #include <string>
+#include <ostream>
 #include <vector>
+#include <memory>
 #include <cstddef>
+#include <cstdint>
+#include <utility>
 
 enum class ImageFormat
 {
 	BMP,
 	JPG,
 	PNG,
+	QOI, // Lossless, encoding many times faster than PNG
+	PPM, // Uncompressed RGB
+	PAM, // Uncompressed RGB, or RGB_ALPHA for 32 bit renders
+};
+
+// A tileset rescaled to a render scale factor and converted to the render pixel format.
+// Immutable once created, so it may be shared between renders and threads.
+struct ScaledTileset
+{
+	FreeImageBmp bitmap;
+	unsigned tileCount;
 };
 
 class RenderManager
@@ -22,27 +42,101 @@ public:
 	static void Initialize();
 	static void Deinitialize();
 
-	// Prints Error messages to console generated by FreeImage
+	// Prints Error messages to console generated by FreeImage. Thread safe.
 	static void FreeImageErrorHandler(FREE_IMAGE_FORMAT fif, const char *message);
 
+	// Sends FreeImage messages raised on the calling thread to messageStream instead of the console.
+	// Pass nullptr to print to the console again.
+	static void SetThreadMessageStream(std::ostream* messageStream);
+
 	// ScaleFactor is the width/height in pixels of each tile.
 	RenderManager(unsigned mapTileWidth, unsigned mapTileHeight, unsigned bpp, unsigned scaleFactor);
 
-	void AddTileset(BYTE* tilesetMemoryPointer, std::size_t tilsesetSize);
+	// Holds only bandTileHeight rows of tiles in memory at once. Render a band at a time with
+	// SetBand, PasteTile and WriteBand to save a render without allocating the full image.
+	RenderManager(unsigned mapTileWidth, unsigned mapTileHeight, unsigned bpp, unsigned scaleFactor, unsigned bandTileHeight);
+
+	// Renders into a caller provided bitmap, such as a view into a reused framebuffer. Its width must
+	// match the map width and its height is a whole number of tile rows, which sets the band height.
+	RenderManager(unsigned mapTileWidth, unsigned mapTileHeight, unsigned scaleFactor, FreeImageBmp&& renderTarget);
+
+	void AddTileset(const BYTE* tilesetMemoryPointer, std::size_t tilsesetSize);
 	void AddTileset(std::string filename, ImageFormat imageFormat);
+	void AddTileset(std::shared_ptr<const ScaledTileset> scaledTileset);
 
+	// Decode a BMP tileset from memory and scale it for use by any RenderManager with matching scaleFactor and bpp
+	static std::shared_ptr<const ScaledTileset> CreateScaledTileset(const BYTE* tilesetMemoryPointer, std::size_t tilesetSize, unsigned scaleFactor, unsigned bpp,
+		ScaleFilter scaleFilter = ScaleFilter::CatmullRom);
+
+	unsigned ScaleFactor() const;
+	unsigned Bpp() const;
+
+	// Pixel dimensions of the whole render, including rows outside of the current band
+	unsigned Width() const;
+	unsigned Height() const;
+
+	// yPos is the map tile row, which must fall within the current band
 	void PasteTile(std::size_t tilesetIndex, std::size_t tileIndex, int xPos, int yPos);
 
-	void SaveMapImage(const std::string& destFilename, ImageFormat imageFormat);
+	// pngPreset sets PNG compression. threadPool, if given, compresses PNG renders across its threads.
+	void SaveMapImage(const std::string& destFilename, ImageFormat imageFormat,
+		PngPreset pngPreset = PngPreset::Balanced, ThreadPool* threadPool = nullptr);
+
+	// Encodes the render in the given image format without writing a file
+	std::vector<BYTE> EncodeMapImage(ImageFormat imageFormat, PngPreset pngPreset = PngPreset::Balanced, ThreadPool* threadPool = nullptr) const;
+
+	// Creates a writer for saving the full size render one band at a time (all formats except JPG)
+	std::unique_ptr<ScanlineWriter> CreateScanlineWriter(const std::string& destFilename, ImageFormat imageFormat,
+		PngPreset pngPreset = PngPreset::Balanced, ThreadPool* threadPool = nullptr) const;
+
+	// Moves the band to start at the given map tile row
+	void SetBand(unsigned firstTileRow);
+
+	// Writes the top tileRowCount rows of tiles in the current band
+	void WriteBand(ScanlineWriter& scanlineWriter, unsigned tileRowCount) const;
+
+	// Saves a rectangle of the current band as its own image, such as one tile of a tile pyramid.
+	// left and top are pixels from the top left of the band. Safe to call concurrently for different files.
+	void SaveBandRegion(const std::string& destFilename, ImageFormat imageFormat, PngPreset pngPreset,
+		unsigned left, unsigned top, unsigned width, unsigned height) const;
+
+	// FNV-1a and CRC-32 hashes of the pixels (and palette) of a rectangle of the current band. Together, accidental
+	// collisions between different pixels are negligible, so equal hashes identify identical tiles.
+	std::pair<uint64_t, uint32_t> HashBandRegion(unsigned left, unsigned top, unsigned width, unsigned height) const;
 
 private:
+	static thread_local std::ostream* threadMessageStream;
+
+	const unsigned mapTileWidth;
+	const unsigned mapTileHeight;
 	const unsigned scaleFactor;
+	const unsigned bytesPerPixel;
+	const TileBlitter::CopyTileFunction copyTile;
 	FreeImageBmp freeImageBmpDest;
-	std::vector<FreeImageBmp> tilesetBmps;
-	// The number of tiles contained in each tileset
-	std::vector<unsigned> tilesetTileCounts;
+	unsigned bandFirstTileRow;
+	std::vector<std::shared_ptr<const ScaledTileset>> tilesets;
+
+	void WriteImage(ScanlineWriter& scanlineWriter) const;
 
+	// Formats encoded without FreeImage, from a file or in memory
+	static bool IsNativeFormat(ImageFormat imageFormat);
+	template<typename Destination>
+	std::unique_ptr<ScanlineWriter> CreateNativeWriter(Destination& destination, ImageFormat imageFormat,
+		unsigned width, unsigned height, PngPreset pngPreset, ThreadPool* threadPool) const;
+	std::vector<RGBQUAD> GetPalette() const;
 	FREE_IMAGE_FORMAT GetFIImageFormat(ImageFormat imageFormat) const;
 	int GetFISaveFlag(ImageFormat imageFormat) const;
-	void AddScaledTileset(const FreeImageBmp& freeImageBmp);
+	static std::shared_ptr<const ScaledTileset> ScaleTileset(const FreeImageBmp& freeImageBmp, unsigned scaleFactor, unsigned bpp,
+		ScaleFilter scaleFilter = ScaleFilter::CatmullRom);
+};
+
+// Keeps FreeImage initialized for the lifetime of the object. Create one for the whole process.
+class FreeImageInitializer
+{
+public:
+	FreeImageInitializer() { RenderManager::Initialize(); }
+	~FreeImageInitializer() { RenderManager::Deinitialize(); }
+
+	FreeImageInitializer(const FreeImageInitializer&) = delete;
+	FreeImageInitializer& operator=(const FreeImageInitializer&) = delete;
 };
@@ -0,0 +1,138 @@
+#include "RenderManifest.h"
+#include "ContentHash.h"
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <random>
+
+// Text file, one tab separated record per line. Keys and filenames are last on their line.
+//   J <input hash> <render count> <job key>
+//   R <render filename>
+const std::string RenderManifest::Header = "OP2MapImager Render Manifest 1";
+
+RenderManifest::RenderManifest(const std::string& filename) : filename(filename), modified(false)
+{
+	Load();
+}
+
+bool RenderManifest::IsUpToDate(const std::string& jobKey, uint64_t inputHash, std::vector<std::string>& renderFilenames) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto iterator = renderRecords.find(jobKey);
+	if (iterator == renderRecords.end() || iterator->second.inputHash != inputHash ||
+		iterator->second.renderFilenames.empty())
+	{
+		return false;
+	}
+
+	for (const auto& renderFilename : iterator->second.renderFilenames)
+	{
+		std::error_code errorCode;
+		if (!std::filesystem::is_regular_file(renderFilename, errorCode)) {
+			return false;
+		}
+	}
+
+	renderFilenames = iterator->second.renderFilenames;
+	return true;
+}
+
+void RenderManifest::Update(const std::string& jobKey, uint64_t inputHash, const std::vector<std::string>& renderFilenames)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	renderRecords[jobKey] = RenderRecord{ inputHash, renderFilenames };
+	modified = true;
+}
+
+void RenderManifest::Save()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (!modified) {
+		return;
+	}
+
+	// Write to a uniquely named file first, so concurrent runs never read a partially written manifest
+	std::random_device randomDevice;
+	const std::string temporaryFilename = filename + "." + std::to_string(randomDevice()) + ".tmp";
+
+	{
+		std::ofstream file(temporaryFilename, std::ios::out | std::ios::trunc);
+		file << Header << '\n';
+
+		for (const auto& renderRecord : renderRecords)
+		{
+			const auto& record = renderRecord.second;
+			file << "J\t" << ContentHash::ToHex(record.inputHash) << '\t' << record.renderFilenames.size() << '\t' <<
+				renderRecord.first << '\n';
+
+			for (const auto& renderFilename : record.renderFilenames) {
+				file << "R\t" << renderFilename << '\n';
+			}
+		}
+
+		file.close();
+
+		if (!file) {
+			std::error_code errorCode;
+			std::filesystem::remove(temporaryFilename, errorCode);
+			return;
+		}
+	}
+
+	std::error_code errorCode;
+	std::filesystem::rename(temporaryFilename, filename, errorCode);
+	if (errorCode) {
+		std::filesystem::remove(temporaryFilename, errorCode);
+		return;
+	}
+
+	modified = false;
+}
+
+void RenderManifest::Load()
+{
+	std::ifstream file(filename);
+	std::string line;
+
+	if (!file || !std::getline(file, line) || line != Header) {
+		return;
+	}
+
+	std::map<std::string, RenderRecord> loadedRecords;
+
+	while (std::getline(file, line))
+	{
+		std::istringstream jobRecord(line);
+		std::string recordType;
+		std::string inputHashHex;
+		std::size_t renderCount;
+		std::string jobKey;
+
+		if (!std::getline(jobRecord, recordType, '\t') || recordType != "J" ||
+			!std::getline(jobRecord, inputHashHex, '\t') || inputHashHex.size() != 16 ||
+			inputHashHex.find_first_not_of("0123456789abcdef") != std::string::npos ||
+			!(jobRecord >> renderCount) || jobRecord.get() != '\t' || !std::getline(jobRecord, jobKey))
+		{
+			// A damaged manifest is discarded, so every map renders again
+			return;
+		}
+
+		RenderRecord record{ std::stoull(inputHashHex, nullptr, 16), {} };
+
+		for (std::size_t i = 0; i < renderCount; ++i)
+		{
+			if (!std::getline(file, line) || line.compare(0, 2, "R\t") != 0) {
+				return;
+			}
+
+			record.renderFilenames.push_back(line.substr(2));
+		}
+
+		loadedRecords[jobKey] = std::move(record);
+	}
+
+	renderRecords = std::move(loadedRecords);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <cstdint>
+
+// Records the files each render job saved along with a hash of the job's inputs, so later runs may skip
+// jobs whose inputs are unchanged and whose renders still exist. Thread safe.
+class RenderManifest
+{
+public:
+	// Loads the manifest file if it exists. A missing or invalid manifest starts an empty manifest.
+	explicit RenderManifest(const std::string& filename);
+
+	// Returns true if the job was saved from the same inputs and every file it saved still exists
+	bool IsUpToDate(const std::string& jobKey, uint64_t inputHash, std::vector<std::string>& renderFilenames) const;
+	void Update(const std::string& jobKey, uint64_t inputHash, const std::vector<std::string>& renderFilenames);
+
+	// Writes the manifest file if the manifest changed. Failures are ignored, so renders are only repeated next run.
+	void Save();
+
+private:
+	struct RenderRecord
+	{
+		uint64_t inputHash;
+		std::vector<std::string> renderFilenames;
+	};
+
+	static const std::string Header;
+
+	const std::string filename;
+	std::map<std::string, RenderRecord> renderRecords;
+	bool modified;
+	mutable std::mutex mutex;
+
+	void Load();
+};
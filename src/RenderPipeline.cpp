@@ -0,0 +1,170 @@
+#include "RenderPipeline.h"
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+RenderPipeline::RenderPipeline(const RenderSettings& renderSettings, shared_ptr<TilesetCache> tilesetCache, size_t queueDepth) :
+	renderSettings(renderSettings),
+	tilesetCache(tilesetCache),
+	encodeThreadPool(renderSettings.threadCount),
+	renderQueue(queueDepth),
+	encodeQueue(queueDepth),
+	writeQueue(queueDepth) { }
+
+void RenderPipeline::Run(const NextJobFunction& nextJob, const JobCompletedFunction& jobCompleted)
+{
+	thread renderThread(&RenderPipeline::RenderStage, this);
+	thread encodeThread(&RenderPipeline::EncodeStage, this);
+	thread writeThread(&RenderPipeline::WriteStage, this, std::cref(jobCompleted));
+
+	ReadStage(nextJob);
+
+	// Each stage closes the queue after it once its input queue is closed and empty
+	renderThread.join();
+	encodeThread.join();
+	writeThread.join();
+}
+
+void RenderPipeline::ReadStage(const NextJobFunction& nextJob)
+{
+	size_t jobIndex;
+	string directory;
+	string filename;
+
+	while (nextJob(jobIndex, directory, filename))
+	{
+		Job job;
+		job.jobIndex = jobIndex;
+		job.filename = filename;
+
+		if (!renderSettings.quiet) {
+			job.output = "Render initialized (May take up to 45 seconds): " + filename + "\n";
+		}
+
+		RunStage(job, [&] {
+			auto& mapImager = mapImagers[directory];
+			if (!mapImager) {
+				mapImager = make_unique<MapImager>(directory, tilesetCache);
+			}
+
+			job.mapImager = mapImager.get();
+			job.preparedMap = make_unique<MapImager::PreparedMap>(job.mapImager->PrepareMap(filename, renderSettings));
+		});
+
+		renderQueue.Push(std::move(job));
+	}
+
+	renderQueue.Close();
+}
+
+void RenderPipeline::RenderStage()
+{
+	Job job;
+	while (renderQueue.Pop(job))
+	{
+		RunStage(job, [&] {
+			job.mapRenders = job.mapImager->RenderPreparedMap(*job.preparedMap, renderSettings);
+		});
+		job.preparedMap.reset();
+
+		encodeQueue.Push(std::move(job));
+	}
+
+	encodeQueue.Close();
+}
+
+void RenderPipeline::EncodeStage()
+{
+	Job job;
+	while (encodeQueue.Pop(job))
+	{
+		RunStage(job, [&] {
+			for (auto& mapRender : job.mapRenders)
+			{
+				if (mapRender.renderManager) {
+					job.encodedImages.emplace_back(mapRender.renderFilename,
+						mapRender.renderManager->EncodeMapImage(renderSettings.imageFormat, renderSettings.pngPreset, &encodeThreadPool));
+				}
+			}
+		});
+
+		// Release renders as soon as they are encoded
+		for (auto& mapRender : job.mapRenders) {
+			mapRender.renderManager.reset();
+		}
+
+		writeQueue.Push(std::move(job));
+	}
+
+	writeQueue.Close();
+}
+
+void RenderPipeline::WriteStage(const JobCompletedFunction& jobCompleted)
+{
+	Job job;
+	while (writeQueue.Pop(job))
+	{
+		RunStage(job, [&] {
+			for (const auto& encodedImage : job.encodedImages) {
+				WriteFile(encodedImage.first, encodedImage.second);
+			}
+		});
+
+		vector<string> renderFilenames;
+		if (!job.failed) {
+			for (const auto& mapRender : job.mapRenders) {
+				renderFilenames.push_back(mapRender.renderFilename);
+			}
+		}
+
+		if (!job.failed && !renderSettings.quiet)
+		{
+			for (const auto& renderFilename : renderFilenames) {
+				job.output += "Render Saved: " + renderFilename + "\n";
+			}
+			job.output += "\n";
+		}
+
+		jobCompleted(job.jobIndex, job.output, renderFilenames, job.error);
+	}
+}
+
+void RenderPipeline::RunStage(Job& job, const function<void()>& stage)
+{
+	if (job.failed) {
+		return;
+	}
+
+	ostringstream output;
+	RenderManager::SetThreadMessageStream(&output);
+
+	try {
+		stage();
+	}
+	catch (const std::exception& e) {
+		output << e.what() << endl << endl;
+		job.failed = true;
+	}
+	catch (...) {
+		job.error = current_exception();
+		job.failed = true;
+	}
+
+	RenderManager::SetThreadMessageStream(nullptr);
+	job.output += output.str();
+}
+
+void RenderPipeline::WriteFile(const string& filename, const vector<BYTE>& data)
+{
+	ofstream file(filename, ios::out | ios::binary | ios::trunc);
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+	file.close();
+
+	if (!file) {
+		throw runtime_error("Error writing render to file: " + filename);
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "MapImager.h"
+#include "BoundedQueue.h"
+#include "TilesetCache.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <functional>
+#include <exception>
+#include <cstddef>
+
+// Renders a sequence of maps in four stages connected by bounded queues: reading the map and its tilesets,
+// rendering, encoding, and writing image files. Each stage runs on its own thread, so the disk and
+// processor work of consecutive maps overlap. Queue depth limits how many maps wait between stages.
+class RenderPipeline
+{
+public:
+	// Supplies the next map to render. Returns false when no maps remain.
+	using NextJobFunction = std::function<bool(std::size_t& jobIndex, std::string& directory, std::string& filename)>;
+
+	// Receives the console output and saved render filenames of a map once its renders are written or it fails.
+	// renderFilenames is empty if the map failed. error holds an exception not derived from std::exception
+	// thrown by a stage, and is otherwise nullptr. Called from the writing thread, in the order maps were supplied.
+	using JobCompletedFunction = std::function<void(std::size_t jobIndex, const std::string& output,
+		const std::vector<std::string>& renderFilenames, std::exception_ptr error)>;
+
+	RenderPipeline(const RenderSettings& renderSettings, std::shared_ptr<TilesetCache> tilesetCache, std::size_t queueDepth);
+
+	// Returns once every supplied map completes
+	void Run(const NextJobFunction& nextJob, const JobCompletedFunction& jobCompleted);
+
+private:
+	// A map moving through the stages. Once a stage fails, later stages pass the map along untouched.
+	struct Job
+	{
+		std::size_t jobIndex = 0;
+		std::string filename;
+		MapImager* mapImager = nullptr;
+		std::string output;
+		bool failed = false;
+		std::exception_ptr error; // Set for exceptions not derived from std::exception, which are not reported in output
+		std::unique_ptr<MapImager::PreparedMap> preparedMap;
+		std::vector<MapImager::MapRender> mapRenders;
+		std::vector<std::pair<std::string, std::vector<BYTE>>> encodedImages; // Render filename, encoded image
+	};
+
+	const RenderSettings renderSettings;
+	std::shared_ptr<TilesetCache> tilesetCache;
+
+	// Maps of the same directory share a MapImager. Created by the reading stage.
+	std::map<std::string, std::unique_ptr<MapImager>> mapImagers;
+
+	// Compresses PNG renders in the encoding stage, separate from the threads rendering the next map
+	ThreadPool encodeThreadPool;
+
+	BoundedQueue<Job> renderQueue;
+	BoundedQueue<Job> encodeQueue;
+	BoundedQueue<Job> writeQueue;
+
+	void ReadStage(const NextJobFunction& nextJob);
+	void RenderStage();
+	void EncodeStage();
+	void WriteStage(const JobCompletedFunction& jobCompleted);
+
+	// Runs one stage of a job, collecting FreeImage messages and any error into the job's output
+	static void RunStage(Job& job, const std::function<void()>& stage);
+	static void WriteFile(const std::string& filename, const std::vector<BYTE>& data);
+};
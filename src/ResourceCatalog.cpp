@@ -0,0 +1,279 @@
+#include "ResourceCatalog.h"
+#include "ArchiveIndexFile.h"
+#include "MemoryMappedFile.h"
+#include "ContentHash.h"
+#include <filesystem>
+#include <regex>
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+
+std::mutex ResourceCatalog::openCatalogsMutex;
+std::map<std::string, std::shared_ptr<ResourceCatalog>> ResourceCatalog::openCatalogs;
+
+ResourceCatalog::ResourceCatalog(const std::string& directory, ArchiveIndexFile* archiveIndexFile) : directory(directory)
+{
+	std::vector<std::filesystem::path> filePaths;
+	for (const auto& directoryEntry : std::filesystem::directory_iterator(directory.empty() ? "." : directory)) {
+		if (directoryEntry.is_regular_file()) {
+			filePaths.push_back(directoryEntry.path());
+		}
+	}
+	std::sort(filePaths.begin(), filePaths.end());
+
+	// Loose files take precedence over archived files of the same name
+	for (const auto& filePath : filePaths) {
+		AddResource(Resource{ filePath.filename().string(), ResourceLocation::Directory, filePath.string(), 0, 0 });
+	}
+
+	for (const auto& filePath : filePaths) {
+		if (XFile::ExtensionMatches(filePath.string(), ".VOL")) {
+			IndexArchive(filePath.string(), archiveIndexFile);
+		}
+	}
+}
+
+std::shared_ptr<ResourceCatalog> ResourceCatalog::Open(const std::string& directory, ArchiveIndexFile* archiveIndexFile)
+{
+	std::lock_guard<std::mutex> lock(openCatalogsMutex);
+
+	auto& resourceCatalog = openCatalogs[directory];
+	if (!resourceCatalog) {
+		resourceCatalog = std::make_shared<ResourceCatalog>(directory, archiveIndexFile);
+	}
+
+	return resourceCatalog;
+}
+
+const std::string& ResourceCatalog::Directory() const
+{
+	return directory;
+}
+
+bool ResourceCatalog::Contains(const std::string& filename, bool accessArchives) const
+{
+	return FindResource(filename, accessArchives) != nullptr;
+}
+
+std::unique_ptr<Stream::BidirectionalSeekableReader> ResourceCatalog::GetResourceStream(const std::string& filename, bool accessArchives)
+{
+	const Resource* resource = FindResource(filename, accessArchives);
+
+	if (resource == nullptr) {
+		return nullptr;
+	}
+
+	if (resource->location == ResourceLocation::ResourceManager) {
+		return OpenResourceManagerStream(*resource);
+	}
+
+	return std::make_unique<ResourceViewReader>(MapResource(*resource));
+}
+
+ResourceView ResourceCatalog::GetResourceView(const std::string& filename, bool accessArchives)
+{
+	const Resource* resource = FindResource(filename, accessArchives);
+
+	if (resource == nullptr) {
+		return ResourceView();
+	}
+
+	if (resource->location != ResourceLocation::ResourceManager) {
+		return MapResource(*resource);
+	}
+
+	// Compressed resources are decompressed into memory
+	auto stream = OpenResourceManagerStream(*resource);
+	if (stream == nullptr) {
+		return ResourceView();
+	}
+
+	const uint64_t streamLength = stream->Length();
+	if (streamLength > std::numeric_limits<std::size_t>::max()) {
+		throw std::runtime_error("Resource " + filename + " is too large to load into memory");
+	}
+
+	auto buffer = std::make_shared<std::vector<char>>(static_cast<std::size_t>(streamLength));
+	stream->Read(*buffer);
+
+	return ResourceView{ buffer, buffer->data(), buffer->size() };
+}
+
+uint64_t ResourceCatalog::GetContentHash(const std::string& filename, bool accessArchives)
+{
+	const std::string upperFilename = StringHelper::ConvertToUpper(filename);
+
+	{
+		std::lock_guard<std::mutex> lock(contentHashesMutex);
+
+		auto iterator = contentHashes.find(upperFilename);
+		if (iterator != contentHashes.end() && FindResource(filename, accessArchives) != nullptr) {
+			return iterator->second;
+		}
+	}
+
+	// Hashed without holding the lock, so different resources may be hashed concurrently
+	const ResourceView resourceView = GetResourceView(filename, accessArchives);
+	if (resourceView.owner == nullptr) {
+		throw std::runtime_error("Unable to find " + filename + " in the directory or in a given archive (.vol).");
+	}
+
+	const uint64_t contentHash = ContentHash::Compute(resourceView.data, resourceView.size);
+
+	std::lock_guard<std::mutex> lock(contentHashesMutex);
+	contentHashes[upperFilename] = contentHash;
+
+	return contentHash;
+}
+
+std::vector<std::string> ResourceCatalog::GetAllFilenames(const std::string& filenameRegexStr, bool accessArchives) const
+{
+	const std::regex filenameRegex(filenameRegexStr, std::regex_constants::icase);
+
+	std::vector<std::string> filenames;
+	for (const auto& resource : resources)
+	{
+		if ((accessArchives || resource.location == ResourceLocation::Directory) &&
+			std::regex_search(resource.filename, filenameRegex))
+		{
+			filenames.push_back(resource.filename);
+		}
+	}
+
+	return filenames;
+}
+
+std::vector<std::string> ResourceCatalog::GetAllFilenamesOfType(const std::string& extension, bool accessArchives) const
+{
+	std::vector<std::string> filenames;
+	for (const auto& resource : resources)
+	{
+		if ((accessArchives || resource.location == ResourceLocation::Directory) &&
+			XFile::ExtensionMatches(resource.filename, extension))
+		{
+			filenames.push_back(resource.filename);
+		}
+	}
+
+	return filenames;
+}
+
+void ResourceCatalog::AddResource(const Resource& resource)
+{
+	if (resourceIndex.emplace(StringHelper::ConvertToUpper(resource.filename), resources.size()).second) {
+		resources.push_back(resource);
+	}
+}
+
+void ResourceCatalog::IndexArchive(const std::string& archivePath, ArchiveIndexFile* archiveIndexFile)
+{
+	std::vector<ArchiveEntry> archiveEntries;
+
+	try {
+		archiveEntries = ReadArchiveEntries(archivePath, archiveIndexFile);
+	}
+	catch (const std::exception&) {
+		// Leave archives this catalog cannot parse to OP2Utility
+		IndexResourceManager();
+		return;
+	}
+
+	for (const auto& archiveEntry : archiveEntries)
+	{
+		AddResource(Resource{
+			archiveEntry.filename,
+			archiveEntry.compressed ? ResourceLocation::ResourceManager : ResourceLocation::Archive,
+			archivePath,
+			archiveEntry.offset,
+			archiveEntry.size
+		});
+	}
+}
+
+void ResourceCatalog::IndexResourceManager()
+{
+	if (resourceManager) {
+		return;
+	}
+
+	resourceManager = std::make_unique<ResourceManager>(directory);
+
+	for (const auto& filename : resourceManager->GetAllFilenames(".*", true)) {
+		AddResource(Resource{ filename, ResourceLocation::ResourceManager, "", 0, 0 });
+	}
+}
+
+std::vector<ArchiveEntry> ResourceCatalog::ReadArchiveEntries(const std::string& archivePath, ArchiveIndexFile* archiveIndexFile)
+{
+	if (archiveIndexFile == nullptr) {
+		return VolIndexReader::ReadEntries(archivePath);
+	}
+
+	const std::string absolutePath = std::filesystem::absolute(archivePath).string();
+	const uint64_t size = std::filesystem::file_size(archivePath);
+	const int64_t modificationTime = std::filesystem::last_write_time(archivePath).time_since_epoch().count();
+
+	std::vector<ArchiveEntry> archiveEntries;
+	if (!archiveIndexFile->Find(absolutePath, modificationTime, size, archiveEntries))
+	{
+		archiveEntries = VolIndexReader::ReadEntries(archivePath);
+		archiveIndexFile->Update(absolutePath, modificationTime, size, archiveEntries);
+	}
+
+	return archiveEntries;
+}
+
+const ResourceCatalog::Resource* ResourceCatalog::FindResource(const std::string& filename, bool accessArchives) const
+{
+	auto iterator = resourceIndex.find(StringHelper::ConvertToUpper(filename));
+
+	if (iterator == resourceIndex.end()) {
+		return nullptr;
+	}
+
+	const Resource& resource = resources[iterator->second];
+	if (!accessArchives && resource.location != ResourceLocation::Directory) {
+		return nullptr;
+	}
+
+	return &resource;
+}
+
+ResourceView ResourceCatalog::MapResource(const Resource& resource)
+{
+	// Loose files are usually read once, so they are mapped for the life of the view only
+	if (resource.location == ResourceLocation::Directory) {
+		auto mappedFile = std::make_shared<const MemoryMappedFile>(resource.path);
+		return ResourceView{ mappedFile, mappedFile->Data(), mappedFile->Size() };
+	}
+
+	std::shared_ptr<const MemoryMappedFile> mappedArchive;
+	{
+		std::lock_guard<std::mutex> lock(mappedArchivesMutex);
+
+		auto& mappedFile = mappedArchives[resource.path];
+		if (!mappedFile) {
+			mappedFile = std::make_shared<const MemoryMappedFile>(resource.path);
+		}
+		mappedArchive = mappedFile;
+	}
+
+	if (!VolIndexReader::IsValidDataBlock(mappedArchive->Data(), mappedArchive->Size(),
+		ArchiveEntry{ resource.filename, resource.offset, resource.size, false }))
+	{
+		throw std::runtime_error("Archive " + resource.path + " has an invalid data block. Its archive index entry may be out of date.");
+	}
+
+	return ResourceView{ mappedArchive, mappedArchive->Data() + resource.offset, static_cast<std::size_t>(resource.size) };
+}
+
+std::unique_ptr<Stream::BidirectionalSeekableReader> ResourceCatalog::OpenResourceManagerStream(const Resource& resource)
+{
+	std::lock_guard<std::mutex> lock(resourceManagerMutex);
+
+	if (!resourceManager) {
+		resourceManager = std::make_unique<ResourceManager>(directory);
+	}
+
+	return resourceManager->GetResourceStream(resource.filename, true);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "OP2Utility.h"
+#include "VolIndexReader.h"
+#include "ResourceView.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <map>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+class ArchiveIndexFile;
+class MemoryMappedFile;
+
+// Scans a directory and the entry tables of its .vol archives once for a whole batch.
+// Resource names are kept in a hash table, so lookups never search the directory or archives.
+// Loose files and uncompressed archived files are read directly from a memory mapping of their file,
+// without copying. A ResourceManager is only opened for compressed files and archives that cannot be parsed.
+// Thread safe. Streams returned may be read concurrently.
+class ResourceCatalog
+{
+public:
+	// archiveIndexFile, if provided, supplies archive entry tables from previous runs
+	explicit ResourceCatalog(const std::string& directory, ArchiveIndexFile* archiveIndexFile = nullptr);
+
+	ResourceCatalog(const ResourceCatalog&) = delete;
+	ResourceCatalog& operator=(const ResourceCatalog&) = delete;
+
+	// Returns the shared catalog of a directory, opening it on first use. archiveIndexFile is only
+	// used when the catalog is opened. Catalogs stay open for the life of the process.
+	static std::shared_ptr<ResourceCatalog> Open(const std::string& directory, ArchiveIndexFile* archiveIndexFile = nullptr);
+
+	const std::string& Directory() const;
+
+	bool Contains(const std::string& filename, bool accessArchives = true) const;
+
+	// Returns nullptr if the resource is not in the directory or, when accessArchives is set, its archives
+	std::unique_ptr<Stream::BidirectionalSeekableReader> GetResourceStream(const std::string& filename, bool accessArchives = true);
+
+	// Returns the resource's bytes without copying them where possible. The view is empty (owner is nullptr)
+	// if the resource is not found.
+	ResourceView GetResourceView(const std::string& filename, bool accessArchives = true);
+
+	// Hash of the resource's contents (see ContentHash), computed once per catalog. Throws if the resource is not found.
+	uint64_t GetContentHash(const std::string& filename, bool accessArchives = true);
+
+	// Matching is case insensitive
+	std::vector<std::string> GetAllFilenames(const std::string& filenameRegexStr, bool accessArchives = true) const;
+	std::vector<std::string> GetAllFilenamesOfType(const std::string& extension, bool accessArchives = true) const;
+
+private:
+	enum class ResourceLocation
+	{
+		Directory,
+		Archive,
+		ResourceManager, // Archived, but only readable through OP2Utility
+	};
+
+	struct Resource
+	{
+		std::string filename;
+		ResourceLocation location;
+		std::string path; // File holding the resource
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	static std::mutex openCatalogsMutex;
+	static std::map<std::string, std::shared_ptr<ResourceCatalog>> openCatalogs;
+
+	const std::string directory;
+	std::vector<Resource> resources; // In the order found
+	std::unordered_map<std::string, std::size_t> resourceIndex; // Uppercase filename to index in resources
+	std::unique_ptr<ResourceManager> resourceManager;
+	std::mutex resourceManagerMutex;
+	std::map<std::string, std::shared_ptr<const MemoryMappedFile>> mappedArchives; // Mapped on first use
+	std::mutex mappedArchivesMutex;
+	std::unordered_map<std::string, uint64_t> contentHashes; // Uppercase filename to content hash
+	std::mutex contentHashesMutex;
+
+	void AddResource(const Resource& resource);
+	void IndexArchive(const std::string& archivePath, ArchiveIndexFile* archiveIndexFile);
+	void IndexResourceManager();
+	static std::vector<ArchiveEntry> ReadArchiveEntries(const std::string& archivePath, ArchiveIndexFile* archiveIndexFile);
+	const Resource* FindResource(const std::string& filename, bool accessArchives) const;
+	ResourceView MapResource(const Resource& resource);
+	std::unique_ptr<Stream::BidirectionalSeekableReader> OpenResourceManagerStream(const Resource& resource);
+};
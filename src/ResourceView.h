@@ -0,0 +1,29 @@
+#pragma once
+
+#include "OP2Utility.h"
+#include <memory>
+#include <cstddef>
+#include <utility>
+
+// The bytes of a resource. owner keeps the memory valid, such as a memory mapping of the file holding the resource.
+struct ResourceView
+{
+	std::shared_ptr<const void> owner;
+	const char* data = nullptr;
+	std::size_t size = 0;
+};
+
+// A Stream::MemoryReader sharing ownership of the memory it reads
+class ResourceViewReader : public Stream::MemoryReader
+{
+public:
+	explicit ResourceViewReader(ResourceView resourceView) :
+		Stream::MemoryReader(resourceView.data, resourceView.size),
+		owner(std::move(resourceView.owner)) { }
+
+	ResourceViewReader(const ResourceViewReader&) = delete;
+	ResourceViewReader& operator=(const ResourceViewReader&) = delete;
+
+private:
+	std::shared_ptr<const void> owner;
+};
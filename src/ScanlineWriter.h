@@ -0,0 +1,19 @@
+#pragma once
+
+#include "../FreeImage/Dist/x32/FreeImage.h"
+#include <cstddef>
+
+// Encodes an image to file as blocks of scanlines arrive, top row first,
+// so an image may be saved without holding all of its pixels in memory at once.
+class ScanlineWriter
+{
+public:
+	virtual ~ScanlineWriter() = default;
+
+	// Pixels use FreeImage byte order (BGR or BGRA). Pitch is the number of bytes from one scanline
+	// to the next scanline below it, and may be negative to walk a bottom-up FreeImage bitmap.
+	virtual void WriteScanlines(const BYTE* topScanline, std::ptrdiff_t pitch, unsigned scanlineCount) = 0;
+
+	// Completes the file. Throws if fewer scanlines than the image height were written.
+	virtual void Finish() = 0;
+};
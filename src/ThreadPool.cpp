@@ -0,0 +1,77 @@
+#include "ThreadPool.h"
+#include <utility>
+
+ThreadPool::ThreadPool(std::size_t threadCount) : stopping(false)
+{
+	if (threadCount == 0) {
+		threadCount = HardwareThreadCount();
+	}
+
+	workers.reserve(threadCount);
+	for (std::size_t i = 0; i < threadCount; ++i) {
+		workers.emplace_back(&ThreadPool::RunWorker, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(tasksMutex);
+		stopping = true;
+	}
+	tasksAvailable.notify_all();
+
+	// Workers finish all queued tasks before exiting
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
+
+std::future<void> ThreadPool::Enqueue(std::function<void()> task)
+{
+	std::packaged_task<void()> packagedTask(std::move(task));
+	std::future<void> future = packagedTask.get_future();
+
+	{
+		std::lock_guard<std::mutex> lock(tasksMutex);
+		tasks.push(std::move(packagedTask));
+	}
+	tasksAvailable.notify_one();
+
+	return future;
+}
+
+std::size_t ThreadPool::ThreadCount() const
+{
+	return workers.size();
+}
+
+std::size_t ThreadPool::HardwareThreadCount()
+{
+	const unsigned hardwareThreadCount = std::thread::hardware_concurrency();
+
+	return hardwareThreadCount == 0 ? 1 : hardwareThreadCount;
+}
+
+void ThreadPool::RunWorker()
+{
+	while (true)
+	{
+		std::packaged_task<void()> task;
+
+		{
+			std::unique_lock<std::mutex> lock(tasksMutex);
+			tasksAvailable.wait(lock, [this] { return stopping || !tasks.empty(); });
+
+			if (tasks.empty()) {
+				return;
+			}
+
+			task = std::move(tasks.front());
+			tasks.pop();
+		}
+
+		// packaged_task stores any exception in the associated future
+		task();
+	}
+}
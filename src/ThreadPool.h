@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <cstddef>
+
+// Fixed set of worker threads executing queued tasks in submission order
+class ThreadPool
+{
+public:
+	// A threadCount of 0 uses one thread per hardware thread
+	explicit ThreadPool(std::size_t threadCount);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Queue a task. Exceptions thrown by the task are rethrown from the returned future's get().
+	std::future<void> Enqueue(std::function<void()> task);
+
+	std::size_t ThreadCount() const;
+
+	// Number of hardware threads, or 1 if it cannot be determined
+	static std::size_t HardwareThreadCount();
+
+private:
+	std::vector<std::thread> workers;
+	std::queue<std::packaged_task<void()>> tasks;
+	std::mutex tasksMutex;
+	std::condition_variable tasksAvailable;
+	bool stopping;
+
+	void RunWorker();
+};
@@ -0,0 +1,317 @@
+#include "TileBlitter.h"
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TILEBLITTER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC allows intrinsics of any instruction set without compiler flags, GCC and Clang require a target attribute
+#if defined(TILEBLITTER_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+void TileBlitter::CopyRows(BYTE* dest, std::size_t destPitch, const BYTE* source, std::size_t sourcePitch,
+	std::size_t rowByteCount, unsigned rowCount)
+{
+	// Selected once on first use. Function local static initialization is thread safe.
+	static const CopyRowsFunction copyRows = SelectCopyRows();
+
+	copyRows(dest, destPitch, source, sourcePitch, rowByteCount, rowCount);
+}
+
+TileBlitter::CopyTileFunction TileBlitter::SelectCopyTile(unsigned scaleFactor, unsigned bytesPerPixel)
+{
+	if (scaleFactor > 8) {
+		return CopyTileGeneric;
+	}
+
+	return SelectFixedCopyTile(scaleFactor, bytesPerPixel);
+}
+
+TileBlitter::CopyTileFunction TileBlitter::SelectFixedCopyTile(unsigned scaleFactor, unsigned bytesPerPixel)
+{
+	const InstructionSet instructionSet = GetInstructionSet();
+
+	switch (bytesPerPixel)
+	{
+	case 1:
+		return SelectCopyTileForPixelSize<1>(scaleFactor, instructionSet);
+	case 3:
+		return SelectCopyTileForPixelSize<3>(scaleFactor, instructionSet);
+	case 4:
+		return SelectCopyTileForPixelSize<4>(scaleFactor, instructionSet);
+	default:
+		return CopyTileGeneric;
+	}
+}
+
+template<unsigned BytesPerPixel>
+TileBlitter::CopyTileFunction TileBlitter::SelectCopyTileForPixelSize(unsigned scaleFactor, InstructionSet instructionSet)
+{
+	switch (scaleFactor)
+	{
+	case 1:
+		return SelectCopyTileFixed<1, BytesPerPixel>(instructionSet);
+	case 2:
+		return SelectCopyTileFixed<2, BytesPerPixel>(instructionSet);
+	case 4:
+		return SelectCopyTileFixed<4, BytesPerPixel>(instructionSet);
+	case 8:
+		return SelectCopyTileFixed<8, BytesPerPixel>(instructionSet);
+	case 16:
+		return SelectCopyTileFixed<16, BytesPerPixel>(instructionSet);
+	case 32:
+		return SelectCopyTileFixed<32, BytesPerPixel>(instructionSet);
+	default:
+		return CopyTileGeneric;
+	}
+}
+
+// Rows shorter than a vector are copied with a constant size memcpy, which the compiler expands into a few moves.
+// This is also what the SIMD row kernels fall back to for short rows.
+template<unsigned ScaleFactor, unsigned BytesPerPixel>
+TileBlitter::CopyTileFunction TileBlitter::SelectCopyTileFixed(InstructionSet instructionSet)
+{
+	constexpr std::size_t rowByteCount = ScaleFactor * BytesPerPixel;
+
+	if constexpr (rowByteCount >= Avx2VectorSize) {
+		if (instructionSet == InstructionSet::AVX2) {
+			return CopyTileFixedAvx2<ScaleFactor, BytesPerPixel>;
+		}
+	}
+	if constexpr (rowByteCount >= Sse2VectorSize) {
+		if (instructionSet != InstructionSet::Scalar) {
+			return CopyTileFixedSse2<ScaleFactor, BytesPerPixel>;
+		}
+	}
+
+	return CopyTileFixedScalar<ScaleFactor, BytesPerPixel>;
+}
+
+void TileBlitter::CopyTileGeneric(BYTE* dest, std::size_t destPitch, const BYTE* source, std::size_t sourcePitch,
+	unsigned scaleFactor, unsigned bytesPerPixel)
+{
+	CopyRows(dest, destPitch, source, sourcePitch, static_cast<std::size_t>(scaleFactor) * bytesPerPixel, scaleFactor);
+}
+
+// The constant row count allows the loop to be unrolled
+template<unsigned ScaleFactor, unsigned BytesPerPixel>
+void TileBlitter::CopyTileFixedScalar(BYTE* dest, std::size_t destPitch, const BYTE* source, std::size_t sourcePitch,
+	unsigned, unsigned)
+{
+	constexpr std::size_t rowByteCount = ScaleFactor * BytesPerPixel;
+
+	for (unsigned row = 0; row < ScaleFactor; ++row)
+	{
+		std::memcpy(dest, source, rowByteCount);
+		source += sourcePitch;
+		dest += destPitch;
+	}
+}
+
+std::string TileBlitter::InstructionSetName()
+{
+	switch (GetInstructionSet())
+	{
+	case InstructionSet::AVX2:
+		return "AVX2";
+	case InstructionSet::SSE2:
+		return "SSE2";
+	default:
+		return "Scalar";
+	}
+}
+
+TileBlitter::InstructionSet TileBlitter::GetInstructionSet()
+{
+	static const InstructionSet instructionSet = DetectInstructionSet();
+
+	return instructionSet;
+}
+
+TileBlitter::InstructionSet TileBlitter::DetectInstructionSet()
+{
+#if defined(TILEBLITTER_X86) && defined(_MSC_VER)
+	int cpuInfo[4];
+	__cpuid(cpuInfo, 0);
+	const int highestFunctionId = cpuInfo[0];
+
+	__cpuid(cpuInfo, 1);
+	const bool sse2 = (cpuInfo[3] & (1 << 26)) != 0;
+	const bool osxsave = (cpuInfo[2] & (1 << 27)) != 0;
+	const bool avx = (cpuInfo[2] & (1 << 28)) != 0;
+
+	if (osxsave && avx && highestFunctionId >= 7) {
+		// Operating system must save the YMM registers on context switch
+		const bool ymmStateEnabled = (_xgetbv(0) & 0x6) == 0x6;
+		__cpuidex(cpuInfo, 7, 0);
+		const bool avx2 = (cpuInfo[1] & (1 << 5)) != 0;
+
+		if (ymmStateEnabled && avx2) {
+			return InstructionSet::AVX2;
+		}
+	}
+
+	return sse2 ? InstructionSet::SSE2 : InstructionSet::Scalar;
+#elif defined(TILEBLITTER_X86)
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2")) {
+		return InstructionSet::AVX2;
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		return InstructionSet::SSE2;
+	}
+
+	return InstructionSet::Scalar;
+#else
+	return InstructionSet::Scalar;
+#endif
+}
+
+TileBlitter::CopyRowsFunction TileBlitter::SelectCopyRows()
+{
+	switch (GetInstructionSet())
+	{
+	case InstructionSet::AVX2:
+		return CopyRowsAvx2;
+	case InstructionSet::SSE2:
+		return CopyRowsSse2;
+	default:
+		return CopyRowsScalar;
+	}
+}
+
+void TileBlitter::CopyRowsScalar(BYTE* dest, std::size_t destPitch, const BYTE* source, std::size_t sourcePitch,
+	std::size_t rowByteCount, unsigned rowCount)
+{
+	for (unsigned row = 0; row < rowCount; ++row)
+	{
+		std::memcpy(dest, source, rowByteCount);
+		source += sourcePitch;
+		dest += destPitch;
+	}
+}
+
+// Tile rows start at arbitrary byte offsets within a 24 bit render, so unaligned loads and stores are used.
+// Rows that are not a multiple of the vector width finish with one vector that overlaps the previous one.
+// Rows shorter than a single vector fall back to memcpy.
+// The fixed tile copies inline the same row copy, so the vector loop is unrolled for a constant row length.
+
+#ifdef TILEBLITTER_X86
+TARGET_SSE2
+inline void TileBlitter::CopyRowSse2(BYTE* dest, const BYTE* source, std::size_t rowByteCount)
+{
+	const std::size_t lastVectorOffset = rowByteCount - Sse2VectorSize;
+
+	for (std::size_t offset = 0; offset < lastVectorOffset; offset += Sse2VectorSize) {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + offset),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + offset)));
+	}
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + lastVectorOffset),
+		_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + lastVectorOffset)));
+}
+
+TARGET_AVX2
+inline void TileBlitter::CopyRowAvx2(BYTE* dest, const BYTE* source, std::size_t rowByteCount)
+{
+	const std::size_t lastVectorOffset = rowByteCount - Avx2VectorSize;
+
+	for (std::size_t offset = 0; offset < lastVectorOffset; offset += Avx2VectorSize) {
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + offset),
+			_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + offset)));
+	}
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + lastVectorOffset),
+		_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + lastVectorOffset)));
+}
+#endif
+
+TARGET_SSE2
+void TileBlitter::CopyRowsSse2(BYTE* dest, std::size_t destPitch, const BYTE* source, std::size_t sourcePitch,
+	std::size_t rowByteCount, unsigned rowCount)
+{
+#ifdef TILEBLITTER_X86
+	if (rowByteCount < Sse2VectorSize) {
+		CopyRowsScalar(dest, destPitch, source, sourcePitch, rowByteCount, rowCount);
+		return;
+	}
+
+	for (unsigned row = 0; row < rowCount; ++row)
+	{
+		CopyRowSse2(dest, source, rowByteCount);
+		source += sourcePitch;
+		dest += destPitch;
+	}
+#else
+	CopyRowsScalar(dest, destPitch, source, sourcePitch, rowByteCount, rowCount);
+#endif
+}
+
+TARGET_AVX2
+void TileBlitter::CopyRowsAvx2(BYTE* dest, std::size_t destPitch, const BYTE* source, std::size_t sourcePitch,
+	std::size_t rowByteCount, unsigned rowCount)
+{
+#ifdef TILEBLITTER_X86
+	if (rowByteCount < Avx2VectorSize) {
+		CopyRowsSse2(dest, destPitch, source, sourcePitch, rowByteCount, rowCount);
+		return;
+	}
+
+	for (unsigned row = 0; row < rowCount; ++row)
+	{
+		CopyRowAvx2(dest, source, rowByteCount);
+		source += sourcePitch;
+		dest += destPitch;
+	}
+#else
+	CopyRowsScalar(dest, destPitch, source, sourcePitch, rowByteCount, rowCount);
+#endif
+}
+
+template<unsigned ScaleFactor, unsigned BytesPerPixel>
+TARGET_SSE2
+void TileBlitter::CopyTileFixedSse2(BYTE* dest, std::size_t destPitch, const BYTE* source, std::size_t sourcePitch,
+	unsigned, unsigned)
+{
+	constexpr std::size_t rowByteCount = ScaleFactor * BytesPerPixel;
+	static_assert(rowByteCount >= Sse2VectorSize, "Row must hold at least one vector");
+
+	for (unsigned row = 0; row < ScaleFactor; ++row)
+	{
+#ifdef TILEBLITTER_X86
+		CopyRowSse2(dest, source, rowByteCount);
+#else
+		std::memcpy(dest, source, rowByteCount);
+#endif
+		source += sourcePitch;
+		dest += destPitch;
+	}
+}
+
+template<unsigned ScaleFactor, unsigned BytesPerPixel>
+TARGET_AVX2
+void TileBlitter::CopyTileFixedAvx2(BYTE* dest, std::size_t destPitch, const BYTE* source, std::size_t sourcePitch,
+	unsigned, unsigned)
+{
+	constexpr std::size_t rowByteCount = ScaleFactor * BytesPerPixel;
+	static_assert(rowByteCount >= Avx2VectorSize, "Row must hold at least one vector");
+
+	for (unsigned row = 0; row < ScaleFactor; ++row)
+	{
+#ifdef TILEBLITTER_X86
+		CopyRowAvx2(dest, source, rowByteCount);
+#else
+		std::memcpy(dest, source, rowByteCount);
+#endif
+		source += sourcePitch;
+		dest += destPitch;
+	}
+}
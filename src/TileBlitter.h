@@ -0,0 +1,80 @@
+#pragma once
+
+#include "../FreeImage/Dist/x32/FreeImage.h"
+#include <string>
+#include <cstddef>
+
+// Copies blocks of scanlines between bitmaps.
+// The widest row copy kernel supported by the CPU (AVX2, SSE2 or scalar) is selected at runtime.
+class TileBlitter
+{
+public:
+	// Copies a square tile of scaleFactor rows, each scaleFactor pixels wide
+	using CopyTileFunction = void(*)(BYTE* dest, std::size_t destPitch, const BYTE* source, std::size_t sourcePitch,
+		unsigned scaleFactor, unsigned bytesPerPixel);
+
+	// Select the fastest tile copy for the scale factor and pixel size: SelectFixedCopyTile for scale factors
+	// up to 8, otherwise CopyTileGeneric. Longer rows are limited by memory bandwidth rather than loop overhead,
+	// and the tile copy benchmark measures fixed copies of scales 16 and 32 within noise of the generic copy.
+	static CopyTileFunction SelectCopyTile(unsigned scaleFactor, unsigned bytesPerPixel);
+
+	// Select a tile copy compiled for the given scale factor and pixel size, so row length and row count
+	// are constants. Rows of at least one vector use the same instruction set as CopyRows.
+	// Returns CopyTileGeneric for uncommon pixel sizes and for scale factors other than 1, 2, 4, 8, 16 and 32.
+	static CopyTileFunction SelectFixedCopyTile(unsigned scaleFactor, unsigned bytesPerPixel);
+
+	static void CopyTileGeneric(BYTE* dest, std::size_t destPitch, const BYTE* source, std::size_t sourcePitch,
+		unsigned scaleFactor, unsigned bytesPerPixel);
+
+	// Copy rowCount rows of rowByteCount bytes. Pitch is the number of bytes between rows.
+	static void CopyRows(BYTE* dest, std::size_t destPitch, const BYTE* source, std::size_t sourcePitch,
+		std::size_t rowByteCount, unsigned rowCount);
+
+	// Name of the instruction set used by CopyRows
+	static std::string InstructionSetName();
+
+private:
+	using CopyRowsFunction = void(*)(BYTE* dest, std::size_t destPitch, const BYTE* source, std::size_t sourcePitch,
+		std::size_t rowByteCount, unsigned rowCount);
+
+	enum class InstructionSet
+	{
+		Scalar,
+		SSE2,
+		AVX2,
+	};
+
+	static constexpr std::size_t Sse2VectorSize = 16;
+	static constexpr std::size_t Avx2VectorSize = 32;
+
+	template<unsigned BytesPerPixel>
+	static CopyTileFunction SelectCopyTileForPixelSize(unsigned scaleFactor, InstructionSet instructionSet);
+	template<unsigned ScaleFactor, unsigned BytesPerPixel>
+	static CopyTileFunction SelectCopyTileFixed(InstructionSet instructionSet);
+
+	// Scale factor and pixel size are template arguments, so the matching parameters are unused
+	template<unsigned ScaleFactor, unsigned BytesPerPixel>
+	static void CopyTileFixedScalar(BYTE* dest, std::size_t destPitch, const BYTE* source, std::size_t sourcePitch,
+		unsigned, unsigned);
+	template<unsigned ScaleFactor, unsigned BytesPerPixel>
+	static void CopyTileFixedSse2(BYTE* dest, std::size_t destPitch, const BYTE* source, std::size_t sourcePitch,
+		unsigned, unsigned);
+	template<unsigned ScaleFactor, unsigned BytesPerPixel>
+	static void CopyTileFixedAvx2(BYTE* dest, std::size_t destPitch, const BYTE* source, std::size_t sourcePitch,
+		unsigned, unsigned);
+
+	static InstructionSet GetInstructionSet();
+	static InstructionSet DetectInstructionSet();
+	static CopyRowsFunction SelectCopyRows();
+
+	static void CopyRowsScalar(BYTE* dest, std::size_t destPitch, const BYTE* source, std::size_t sourcePitch,
+		std::size_t rowByteCount, unsigned rowCount);
+	static void CopyRowsSse2(BYTE* dest, std::size_t destPitch, const BYTE* source, std::size_t sourcePitch,
+		std::size_t rowByteCount, unsigned rowCount);
+	static void CopyRowsAvx2(BYTE* dest, std::size_t destPitch, const BYTE* source, std::size_t sourcePitch,
+		std::size_t rowByteCount, unsigned rowCount);
+
+	// Copy a single row of at least one vector, shared by the row and fixed tile copies
+	static void CopyRowSse2(BYTE* dest, const BYTE* source, std::size_t rowByteCount);
+	static void CopyRowAvx2(BYTE* dest, const BYTE* source, std::size_t rowByteCount);
+};
@@ -0,0 +1,104 @@
+#include "TilesetBmpDecoder.h"
+#include <stdexcept>
+#include <limits>
+#include <cstring>
+
+const unsigned TilesetBmpDecoder::TileLength = 32;
+const std::size_t TilesetBmpDecoder::FileHeaderSize = 14;
+const std::size_t TilesetBmpDecoder::InfoHeaderSize = 40;
+
+std::unique_ptr<FreeImageBmp> TilesetBmpDecoder::Decode(const BYTE* data, std::size_t size, unsigned bpp)
+{
+	if ((bpp != 24 && bpp != 32) || size < FileHeaderSize + InfoHeaderSize || data[0] != 'B' || data[1] != 'M') {
+		return nullptr;
+	}
+
+	const uint32_t pixelDataOffset = ReadUint32(data + 10);
+
+	// Later info header versions (V4, V5) extend the 40 byte header, and are read the same way
+	const BYTE* infoHeader = data + FileHeaderSize;
+	const uint32_t infoHeaderSize = ReadUint32(infoHeader);
+	const int32_t width = static_cast<int32_t>(ReadUint32(infoHeader + 4));
+	const int32_t height = static_cast<int32_t>(ReadUint32(infoHeader + 8));
+	const uint16_t planes = ReadUint16(infoHeader + 12);
+	const uint16_t bitCount = ReadUint16(infoHeader + 14);
+	const uint32_t compression = ReadUint32(infoHeader + 16);
+	uint32_t paletteCount = ReadUint32(infoHeader + 32);
+
+	// Top-down tilesets, other pixel formats and compressed tilesets are left to FreeImage
+	if (infoHeaderSize < InfoHeaderSize || width != static_cast<int32_t>(TileLength) || height <= 0 ||
+		planes != 1 || bitCount != 8 || compression != 0 /* BI_RGB */ || paletteCount > 256)
+	{
+		return nullptr;
+	}
+
+	if (height % TileLength != 0) {
+		throw std::runtime_error("Source tileset height must be an integer multiple of " +
+			std::to_string(TileLength) + " pixels (tile size)");
+	}
+
+	if (paletteCount == 0) {
+		paletteCount = 256;
+	}
+
+	// Rows are padded to a multiple of 4 bytes, which a 32 pixel wide 8 bit row already is
+	const std::size_t sourcePitch = TileLength;
+	const std::size_t paletteOffset = FileHeaderSize + infoHeaderSize;
+
+	if (paletteOffset > size || paletteCount > (size - paletteOffset) / sizeof(RGBQUAD) ||
+		pixelDataOffset > size || static_cast<std::size_t>(height) > (size - pixelDataOffset) / sourcePitch)
+	{
+		throw std::runtime_error("Tileset bitmap is truncated");
+	}
+
+	// Indices past the end of a short palette decode as black
+	RGBQUAD palette[256] = {};
+	std::memcpy(palette, data + paletteOffset, paletteCount * sizeof(RGBQUAD));
+
+	auto bitmap = std::make_unique<FreeImageBmp>(TileLength, height, bpp);
+
+	if (bpp == 24) {
+		ExpandPixels<3>(data + pixelDataOffset, sourcePitch, palette, *bitmap);
+	}
+	else {
+		ExpandPixels<4>(data + pixelDataOffset, sourcePitch, palette, *bitmap);
+	}
+
+	return bitmap;
+}
+
+// Both BMP and FreeImage store scanlines bottom-up, so source row y is bitmap scanline y
+template<unsigned BytesPerPixel>
+void TilesetBmpDecoder::ExpandPixels(const BYTE* pixelData, std::size_t sourcePitch, const RGBQUAD* palette, FreeImageBmp& bitmap)
+{
+	for (unsigned y = 0; y < bitmap.Height(); ++y)
+	{
+		const BYTE* source = pixelData + y * sourcePitch;
+		BYTE* dest = bitmap.ScanLine(y);
+
+		for (unsigned x = 0; x < TileLength; ++x)
+		{
+			const RGBQUAD& color = palette[source[x]];
+			dest[FI_RGBA_RED] = color.rgbRed;
+			dest[FI_RGBA_GREEN] = color.rgbGreen;
+			dest[FI_RGBA_BLUE] = color.rgbBlue;
+			if (BytesPerPixel == 4) {
+				dest[FI_RGBA_ALPHA] = 0xFF;
+			}
+			dest += BytesPerPixel;
+		}
+	}
+}
+
+uint32_t TilesetBmpDecoder::ReadUint32(const BYTE* bytes)
+{
+	return static_cast<uint32_t>(bytes[0]) |
+		(static_cast<uint32_t>(bytes[1]) << 8) |
+		(static_cast<uint32_t>(bytes[2]) << 16) |
+		(static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+uint16_t TilesetBmpDecoder::ReadUint16(const BYTE* bytes)
+{
+	return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
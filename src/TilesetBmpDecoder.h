@@ -0,0 +1,28 @@
+#pragma once
+
+#include "FreeImageBmp.h"
+#include "../FreeImage/Dist/x32/FreeImage.h"
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+// Decodes the BMP layout of Outpost 2 tilesets: an uncompressed, bottom-up, 8 bit palettized strip of tiles
+// 32 pixels wide. Palette indices are expanded straight into a bitmap of the render pixel format.
+class TilesetBmpDecoder
+{
+public:
+	// Returns nullptr if the file is not of this layout or bpp is not 24 or 32, so a general decoder may be used.
+	// Throws if the file claims this layout but its palette or pixels are truncated.
+	static std::unique_ptr<FreeImageBmp> Decode(const BYTE* data, std::size_t size, unsigned bpp);
+
+private:
+	static const unsigned TileLength;
+	static const std::size_t FileHeaderSize;
+	static const std::size_t InfoHeaderSize;
+
+	template<unsigned BytesPerPixel>
+	static void ExpandPixels(const BYTE* pixelData, std::size_t sourcePitch, const RGBQUAD* palette, FreeImageBmp& bitmap);
+
+	static uint32_t ReadUint32(const BYTE* bytes);
+	static uint16_t ReadUint16(const BYTE* bytes);
+};
@@ -0,0 +1,94 @@
+#include "TilesetCache.h"
+#include "TilesetDiskCache.h"
+#include <functional>
+
+bool TilesetCacheKey::operator==(const TilesetCacheKey& other) const
+{
+	return tilesetName == other.tilesetName &&
+		contentHash == other.contentHash &&
+		scaleFactor == other.scaleFactor &&
+		bpp == other.bpp &&
+		scaleFilter == other.scaleFilter;
+}
+
+TilesetCache::TilesetCache(const std::string& diskCacheDirectory)
+{
+	if (!diskCacheDirectory.empty()) {
+		diskCache = std::make_unique<TilesetDiskCache>(diskCacheDirectory);
+	}
+}
+
+// Defined here, where TilesetDiskCache is a complete type
+TilesetCache::~TilesetCache() { }
+
+std::shared_ptr<const ScaledTileset> TilesetCache::Find(const TilesetCacheKey& key) const
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto iterator = scaledTilesets.find(key);
+		if (iterator != scaledTilesets.end()) {
+			return iterator->second;
+		}
+	}
+
+	if (!diskCache) {
+		return nullptr;
+	}
+
+	// Disk reads happen outside the lock so other threads may use the memory cache meanwhile
+	auto scaledTileset = diskCache->Load(key);
+	if (scaledTileset) {
+		std::lock_guard<std::mutex> lock(mutex);
+		scaledTilesets.emplace(key, scaledTileset);
+	}
+
+	return scaledTileset;
+}
+
+void TilesetCache::Insert(const TilesetCacheKey& key, std::shared_ptr<const ScaledTileset> scaledTileset)
+{
+	if (diskCache) {
+		diskCache->Store(key, *scaledTileset);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	scaledTilesets[key] = std::move(scaledTileset);
+}
+
+TilesetCache::ScaledTilesets TilesetCache::FindIndexed(const std::vector<TilesetCacheKey>& keys) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto iterator = indexedTilesets.find(keys);
+	if (iterator == indexedTilesets.end()) {
+		return {};
+	}
+
+	return iterator->second;
+}
+
+void TilesetCache::InsertIndexed(const std::vector<TilesetCacheKey>& keys, ScaledTilesets tilesets)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	indexedTilesets[keys] = std::move(tilesets);
+}
+
+std::size_t TilesetCache::KeyHash::operator()(const TilesetCacheKey& key) const
+{
+	// The content hash already identifies the tileset, so combine the remaining fields cheaply
+	return std::hash<uint64_t>()(key.contentHash ^ (static_cast<uint64_t>(key.scaleFactor) << 32) ^
+		(static_cast<uint64_t>(key.scaleFilter) << 8) ^ key.bpp);
+}
+
+std::size_t TilesetCache::KeysHash::operator()(const std::vector<TilesetCacheKey>& keys) const
+{
+	std::size_t hash = keys.size();
+	for (const auto& key : keys) {
+		hash = hash * 31 + KeyHash()(key);
+	}
+
+	return hash;
+}
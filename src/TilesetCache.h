@@ -0,0 +1,61 @@
+#pragma once
+
+#include "RenderManager.h"
+#include <string>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Identifies a scaled tileset. The content hash distinguishes tilesets of the same name from different directories.
+struct TilesetCacheKey
+{
+	std::string tilesetName; // Uppercase
+	uint64_t contentHash;
+	unsigned scaleFactor;
+	unsigned bpp;
+	ScaleFilter scaleFilter;
+
+	bool operator==(const TilesetCacheKey& other) const;
+};
+
+class TilesetDiskCache;
+
+// Keeps scaled tilesets in memory so later maps of a batch skip decoding and rescaling them.
+// When given a cache directory, tilesets are also kept on disk for later runs. Thread safe.
+// Indexed color conversions of a map's tilesets are kept in memory only, keyed by the keys of the converted tilesets.
+class TilesetCache
+{
+public:
+	using ScaledTilesets = std::vector<std::shared_ptr<const ScaledTileset>>;
+
+	// An empty diskCacheDirectory keeps tilesets in memory only
+	explicit TilesetCache(const std::string& diskCacheDirectory = "");
+	~TilesetCache();
+
+	// Returns nullptr if the tileset is not cached
+	std::shared_ptr<const ScaledTileset> Find(const TilesetCacheKey& key) const;
+	void Insert(const TilesetCacheKey& key, std::shared_ptr<const ScaledTileset> scaledTileset);
+
+	// Returns an empty list if the tilesets have not been converted to indexed color together
+	ScaledTilesets FindIndexed(const std::vector<TilesetCacheKey>& keys) const;
+	void InsertIndexed(const std::vector<TilesetCacheKey>& keys, ScaledTilesets tilesets);
+
+private:
+	struct KeyHash
+	{
+		std::size_t operator()(const TilesetCacheKey& key) const;
+	};
+
+	struct KeysHash
+	{
+		std::size_t operator()(const std::vector<TilesetCacheKey>& keys) const;
+	};
+
+	mutable std::mutex mutex;
+	mutable std::unordered_map<TilesetCacheKey, std::shared_ptr<const ScaledTileset>, KeyHash> scaledTilesets;
+	std::unordered_map<std::vector<TilesetCacheKey>, ScaledTilesets, KeysHash> indexedTilesets;
+	std::unique_ptr<TilesetDiskCache> diskCache;
+};
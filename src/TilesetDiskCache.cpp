@@ -0,0 +1,105 @@
+#include "TilesetDiskCache.h"
+#include "ContentHash.h"
+#include <fstream>
+#include <filesystem>
+#include <random>
+#include <cstring>
+
+const char TilesetDiskCache::Tag[4] = { 'O', 'P', '2', 'T' };
+const uint32_t TilesetDiskCache::Version = 2;
+
+TilesetDiskCache::TilesetDiskCache(const std::string& directory) : directory(directory)
+{
+	std::error_code errorCode;
+	std::filesystem::create_directories(directory, errorCode);
+}
+
+std::shared_ptr<const ScaledTileset> TilesetDiskCache::Load(const TilesetCacheKey& key) const
+{
+	std::ifstream file(GetCacheFilename(key), std::ios::in | std::ios::binary);
+	if (!file) {
+		return nullptr;
+	}
+
+	FileHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+	if (!file ||
+		std::memcmp(header.tag, Tag, sizeof(Tag)) != 0 ||
+		header.version != Version ||
+		header.contentHash != key.contentHash ||
+		header.scaleFactor != key.scaleFactor ||
+		header.bpp != key.bpp ||
+		header.scaleFilter != static_cast<uint32_t>(key.scaleFilter) ||
+		header.tileCount == 0 ||
+		header.tileCount > UINT32_MAX / key.scaleFactor)
+	{
+		return nullptr;
+	}
+
+	FreeImageBmp bitmap(key.scaleFactor, header.tileCount * key.scaleFactor, key.bpp);
+	if (bitmap.Pitch() != header.pitch) {
+		return nullptr;
+	}
+
+	// FreeImage scanlines are contiguous, so all pixels are read at once
+	const std::size_t pixelByteCount = static_cast<std::size_t>(bitmap.Pitch()) * bitmap.Height();
+	file.read(reinterpret_cast<char*>(bitmap.ScanLine(0)), pixelByteCount);
+
+	if (!file || file.peek() != std::ifstream::traits_type::eof()) {
+		return nullptr;
+	}
+
+	return std::make_shared<const ScaledTileset>(ScaledTileset{ std::move(bitmap), header.tileCount });
+}
+
+void TilesetDiskCache::Store(const TilesetCacheKey& key, const ScaledTileset& scaledTileset) const
+{
+	const std::string filename = GetCacheFilename(key);
+
+	// Write to a uniquely named file first, so concurrent runs never read a partially written entry
+	std::random_device randomDevice;
+	const std::string temporaryFilename = filename + "." + std::to_string(randomDevice()) + ".tmp";
+
+	FileHeader header;
+	std::memcpy(header.tag, Tag, sizeof(Tag));
+	header.version = Version;
+	header.contentHash = key.contentHash;
+	header.scaleFactor = key.scaleFactor;
+	header.bpp = key.bpp;
+	header.scaleFilter = static_cast<uint32_t>(key.scaleFilter);
+	header.tileCount = scaledTileset.tileCount;
+	header.pitch = scaledTileset.bitmap.Pitch();
+	header.reserved = 0;
+
+	const std::size_t pixelByteCount = static_cast<std::size_t>(header.pitch) * scaledTileset.bitmap.Height();
+
+	{
+		std::ofstream file(temporaryFilename, std::ios::out | std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(scaledTileset.bitmap.ScanLine(0)), pixelByteCount);
+		file.close();
+
+		if (!file) {
+			std::error_code errorCode;
+			std::filesystem::remove(temporaryFilename, errorCode);
+			return;
+		}
+	}
+
+	std::error_code errorCode;
+	std::filesystem::rename(temporaryFilename, filename, errorCode);
+	if (errorCode) {
+		std::filesystem::remove(temporaryFilename, errorCode);
+	}
+}
+
+std::string TilesetDiskCache::GetCacheFilename(const TilesetCacheKey& key) const
+{
+	const std::string filename = ContentHash::ToHex(key.contentHash) +
+		".s" + std::to_string(key.scaleFactor) +
+		".b" + std::to_string(key.bpp) +
+		".f" + std::to_string(static_cast<uint32_t>(key.scaleFilter)) + ".op2tileset";
+
+	return (std::filesystem::path(directory) / filename).string();
+}
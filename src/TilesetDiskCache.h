@@ -0,0 +1,45 @@
+#pragma once
+
+#include "TilesetCache.h"
+#include <string>
+#include <memory>
+#include <cstdint>
+
+// Stores scaled tilesets as raw files so later runs skip decoding and rescaling them.
+// A file holds a fixed size header followed by the pixel rows laid out exactly as in the
+// FreeImage bitmap (bottom-up, pitch aligned), so it may be read or memory mapped without conversion.
+// Fields are stored in native byte order; cache files are only meant for the machine that wrote them.
+class TilesetDiskCache
+{
+public:
+	explicit TilesetDiskCache(const std::string& directory);
+
+	// Returns nullptr if the tileset is not cached or the cache file is invalid
+	std::shared_ptr<const ScaledTileset> Load(const TilesetCacheKey& key) const;
+
+	// Failures are ignored, since the cache only speeds up later runs
+	void Store(const TilesetCacheKey& key, const ScaledTileset& scaledTileset) const;
+
+private:
+	struct FileHeader
+	{
+		char tag[4];
+		uint32_t version;
+		uint64_t contentHash;
+		uint32_t scaleFactor;
+		uint32_t bpp;
+		uint32_t scaleFilter;
+		uint32_t tileCount;
+		uint32_t pitch;
+		// Written as 0. Names the bytes that would otherwise be padding, so no uninitialized memory is written.
+		uint32_t reserved;
+	};
+	static_assert(sizeof(FileHeader) == 40, "FileHeader must have no padding");
+
+	static const char Tag[4];
+	static const uint32_t Version;
+
+	const std::string directory;
+
+	std::string GetCacheFilename(const TilesetCacheKey& key) const;
+};
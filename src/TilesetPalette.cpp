@@ -0,0 +1,144 @@
+#include "TilesetPalette.h"
+#include <stdexcept>
+#include <cstring>
+
+const std::size_t TilesetPalette::MaxColorCount = 256;
+
+TilesetPalette::ScaledTilesets TilesetPalette::ConvertToIndexed(const ScaledTilesets& tilesets)
+{
+	for (const auto& tileset : tilesets)
+	{
+		if (tileset->bitmap.Bpp() != 24 || tileset->bitmap.Width() != tilesets[0]->bitmap.Width()) {
+			throw std::runtime_error("Only 24 bit tilesets of equal width may be converted to indexed color");
+		}
+	}
+
+	std::vector<uint32_t> colors;
+	if (FindColors(tilesets, colors)) {
+		return ConvertExact(tilesets, colors);
+	}
+
+	return ConvertQuantized(tilesets);
+}
+
+bool TilesetPalette::FindColors(const ScaledTilesets& tilesets, std::vector<uint32_t>& colors)
+{
+	// One bit for each 24 bit color
+	std::vector<uint64_t> colorsFound((1 << 24) / 64, 0);
+
+	for (const auto& tileset : tilesets)
+	{
+		const FreeImageBmp& bitmap = tileset->bitmap;
+
+		for (unsigned y = 0; y < bitmap.Height(); ++y)
+		{
+			const BYTE* pixel = bitmap.ScanLine(y);
+
+			for (unsigned x = 0; x < bitmap.Width(); ++x, pixel += 3)
+			{
+				const uint32_t color = ReadColor(pixel);
+				uint64_t& colorBits = colorsFound[color / 64];
+				const uint64_t colorBit = static_cast<uint64_t>(1) << (color % 64);
+
+				if ((colorBits & colorBit) == 0) {
+					if (colors.size() == MaxColorCount) {
+						return false;
+					}
+
+					colorBits |= colorBit;
+					colors.push_back(color);
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+TilesetPalette::ScaledTilesets TilesetPalette::ConvertExact(const ScaledTilesets& tilesets, const std::vector<uint32_t>& colors)
+{
+	// Palette index of each 24 bit color, indexed by the color. Only colors found in the tilesets are looked up.
+	std::vector<BYTE> colorIndices(1 << 24);
+	for (std::size_t i = 0; i < colors.size(); ++i) {
+		colorIndices[colors[i]] = static_cast<BYTE>(i);
+	}
+
+	ScaledTilesets indexedTilesets;
+
+	for (const auto& tileset : tilesets)
+	{
+		const FreeImageBmp& bitmap = tileset->bitmap;
+		FreeImageBmp indexedBitmap(bitmap.Width(), bitmap.Height(), 8);
+
+		// Unused palette entries stay black
+		RGBQUAD* palette = indexedBitmap.Palette();
+		std::memset(palette, 0, MaxColorCount * sizeof(RGBQUAD));
+		for (std::size_t i = 0; i < colors.size(); ++i) {
+			palette[i].rgbRed = static_cast<BYTE>(colors[i] >> 16);
+			palette[i].rgbGreen = static_cast<BYTE>(colors[i] >> 8);
+			palette[i].rgbBlue = static_cast<BYTE>(colors[i]);
+		}
+
+		for (unsigned y = 0; y < bitmap.Height(); ++y)
+		{
+			const BYTE* pixel = bitmap.ScanLine(y);
+			BYTE* index = indexedBitmap.ScanLine(y);
+
+			for (unsigned x = 0; x < bitmap.Width(); ++x, pixel += 3) {
+				index[x] = colorIndices[ReadColor(pixel)];
+			}
+		}
+
+		indexedTilesets.push_back(std::make_shared<const ScaledTileset>(ScaledTileset{ std::move(indexedBitmap), tileset->tileCount }));
+	}
+
+	return indexedTilesets;
+}
+
+// Tilesets are stacked into one bitmap, so a single palette is chosen from the colors of every tileset
+TilesetPalette::ScaledTilesets TilesetPalette::ConvertQuantized(const ScaledTilesets& tilesets)
+{
+	const unsigned width = tilesets[0]->bitmap.Width();
+	const std::size_t rowByteCount = static_cast<std::size_t>(width) * 3;
+
+	unsigned stackedHeight = 0;
+	for (const auto& tileset : tilesets) {
+		stackedHeight += tileset->bitmap.Height();
+	}
+
+	FreeImageBmp stackedBitmap(width, stackedHeight, 24);
+
+	unsigned stackedY = 0;
+	for (const auto& tileset : tilesets) {
+		for (unsigned y = 0; y < tileset->bitmap.Height(); ++y, ++stackedY) {
+			std::memcpy(stackedBitmap.ScanLine(stackedY), tileset->bitmap.ScanLine(y), rowByteCount);
+		}
+	}
+
+	const FreeImageBmp quantizedBitmap = stackedBitmap.ColorQuantize(FIQ_WUQUANT);
+
+	ScaledTilesets indexedTilesets;
+
+	stackedY = 0;
+	for (const auto& tileset : tilesets)
+	{
+		FreeImageBmp indexedBitmap(width, tileset->bitmap.Height(), 8);
+		std::memcpy(indexedBitmap.Palette(), quantizedBitmap.Palette(), MaxColorCount * sizeof(RGBQUAD));
+
+		for (unsigned y = 0; y < indexedBitmap.Height(); ++y, ++stackedY) {
+			std::memcpy(indexedBitmap.ScanLine(y), quantizedBitmap.ScanLine(stackedY), width);
+		}
+
+		indexedTilesets.push_back(std::make_shared<const ScaledTileset>(ScaledTileset{ std::move(indexedBitmap), tileset->tileCount }));
+	}
+
+	return indexedTilesets;
+}
+
+// Packs a pixel in FreeImage byte order as 0xRRGGBB
+uint32_t TilesetPalette::ReadColor(const BYTE* pixel)
+{
+	return (static_cast<uint32_t>(pixel[FI_RGBA_RED]) << 16) |
+		(static_cast<uint32_t>(pixel[FI_RGBA_GREEN]) << 8) |
+		static_cast<uint32_t>(pixel[FI_RGBA_BLUE]);
+}
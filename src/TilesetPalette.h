@@ -0,0 +1,28 @@
+#pragma once
+
+#include "RenderManager.h"
+#include "../FreeImage/Dist/x32/FreeImage.h"
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+// Converts the scaled tilesets of a render to 8 bit indexed color sharing a single palette, so the render
+// may be drawn at 1 byte per pixel. Tilesets holding 256 colors or fewer in total keep their exact colors.
+// Otherwise colors are reduced to 256 with FreeImage's Wu quantizer.
+class TilesetPalette
+{
+public:
+	using ScaledTilesets = std::vector<std::shared_ptr<const ScaledTileset>>;
+
+	// Tilesets must be 24 bits per pixel and share a tile width
+	static ScaledTilesets ConvertToIndexed(const ScaledTilesets& tilesets);
+
+private:
+	static const std::size_t MaxColorCount;
+
+	// Colors in order of first use. Returns false once more than MaxColorCount colors are found.
+	static bool FindColors(const ScaledTilesets& tilesets, std::vector<uint32_t>& colors);
+	static ScaledTilesets ConvertExact(const ScaledTilesets& tilesets, const std::vector<uint32_t>& colors);
+	static ScaledTilesets ConvertQuantized(const ScaledTilesets& tilesets);
+	static uint32_t ReadColor(const BYTE* pixel);
+};
@@ -0,0 +1,126 @@
+#include "VolIndexReader.h"
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+
+// Fields are little endian. Each section starts with a 4 character tag and a 32 bit length.
+// The top bit of the length is a flag, not part of the length.
+const uint16_t VolIndexReader::UncompressedType = 0x100;
+const std::size_t VolIndexReader::IndexEntrySize = 14;
+const std::size_t VolIndexReader::SectionHeaderSize = 8;
+
+std::vector<ArchiveEntry> VolIndexReader::ReadEntries(const std::string& volFilename)
+{
+	std::ifstream archive(volFilename, std::ios::in | std::ios::binary | std::ios::ate);
+	if (!archive) {
+		throw std::runtime_error("Unable to open archive " + volFilename);
+	}
+
+	const uint64_t archiveSize = static_cast<uint64_t>(archive.tellg());
+	archive.seekg(0);
+
+	// Header sections: "VOL " encloses "volh", the "vols" string table and the "voli" entry table
+	ReadSectionHeader(archive, archiveSize, "VOL ");
+
+	const SectionHeader volhHeader = ReadSectionHeader(archive, archiveSize, "volh");
+	archive.seekg(volhHeader.endPosition);
+
+	const SectionHeader volsHeader = ReadSectionHeader(archive, archiveSize, "vols");
+	char stringTableLengthBytes[4];
+	archive.read(stringTableLengthBytes, sizeof(stringTableLengthBytes));
+	const uint32_t stringTableLength = ReadUint32(stringTableLengthBytes);
+
+	if (!archive || stringTableLength > volsHeader.length) {
+		throw std::runtime_error("Archive " + volFilename + " has an invalid string table");
+	}
+
+	std::vector<char> stringTable(stringTableLength);
+	archive.read(stringTable.data(), stringTable.size());
+	archive.seekg(volsHeader.endPosition);
+
+	const SectionHeader voliHeader = ReadSectionHeader(archive, archiveSize, "voli");
+	std::vector<char> indexTable(voliHeader.length);
+	archive.read(indexTable.data(), indexTable.size());
+
+	if (!archive) {
+		throw std::runtime_error("Archive " + volFilename + " has an invalid entry table");
+	}
+
+	std::vector<ArchiveEntry> archiveEntries;
+
+	for (std::size_t offset = 0; offset + IndexEntrySize <= indexTable.size(); offset += IndexEntrySize)
+	{
+		const char* indexEntry = &indexTable[offset];
+		const uint32_t filenameOffset = ReadUint32(indexEntry);
+		const uint32_t dataBlockOffset = ReadUint32(indexEntry + 4);
+		const uint32_t fileSize = ReadUint32(indexEntry + 8);
+		const uint16_t compressionType = ReadUint16(indexEntry + 12);
+
+		// The entry table is padded, so entries without a name end the table
+		if (filenameOffset >= stringTable.size()) {
+			break;
+		}
+
+		const char* filename = stringTable.data() + filenameOffset;
+		const std::size_t filenameLength = std::find(filename, filename + (stringTable.size() - filenameOffset), '\0') - filename;
+		if (filenameLength == 0) {
+			break;
+		}
+
+		archiveEntries.push_back(ArchiveEntry{
+			std::string(filename, filenameLength),
+			static_cast<uint64_t>(dataBlockOffset) + SectionHeaderSize,
+			fileSize,
+			compressionType != UncompressedType
+		});
+	}
+
+	return archiveEntries;
+}
+
+bool VolIndexReader::IsValidDataBlock(const char* archiveData, std::size_t archiveSize, const ArchiveEntry& archiveEntry)
+{
+	if (archiveEntry.offset < SectionHeaderSize || archiveEntry.offset > archiveSize ||
+		archiveEntry.size > archiveSize - archiveEntry.offset)
+	{
+		return false;
+	}
+
+	const char* header = archiveData + (archiveEntry.offset - SectionHeaderSize);
+
+	return std::memcmp(header, "VBLK", 4) == 0 &&
+		(ReadUint32(header + 4) & 0x7FFFFFFF) >= archiveEntry.size;
+}
+
+// Section lengths are checked against the archive size, so a damaged length never allocates more than the archive holds
+VolIndexReader::SectionHeader VolIndexReader::ReadSectionHeader(std::ifstream& archive, uint64_t archiveSize, const char* expectedTag)
+{
+	char header[SectionHeaderSize];
+	archive.read(header, sizeof(header));
+
+	if (!archive || std::memcmp(header, expectedTag, 4) != 0) {
+		throw std::runtime_error("Archive section " + std::string(expectedTag) + " is missing");
+	}
+
+	const uint32_t length = ReadUint32(header + 4) & 0x7FFFFFFF;
+	const uint64_t endPosition = static_cast<uint64_t>(archive.tellg()) + length;
+
+	if (endPosition > archiveSize) {
+		throw std::runtime_error("Archive section " + std::string(expectedTag) + " is truncated");
+	}
+
+	return SectionHeader{ length, endPosition };
+}
+
+uint32_t VolIndexReader::ReadUint32(const char* bytes)
+{
+	const unsigned char* b = reinterpret_cast<const unsigned char*>(bytes);
+	return static_cast<uint32_t>(b[0]) | (static_cast<uint32_t>(b[1]) << 8) |
+		(static_cast<uint32_t>(b[2]) << 16) | (static_cast<uint32_t>(b[3]) << 24);
+}
+
+uint16_t VolIndexReader::ReadUint16(const char* bytes)
+{
+	const unsigned char* b = reinterpret_cast<const unsigned char*>(bytes);
+	return static_cast<uint16_t>(b[0] | (b[1] << 8));
+}
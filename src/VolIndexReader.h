@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstddef>
+
+// A file stored in an archive. offset is the position of the file's data within the archive.
+struct ArchiveEntry
+{
+	std::string filename;
+	uint64_t offset;
+	uint64_t size;
+	bool compressed;
+};
+
+// Reads the entry table of an Outpost 2 .vol archive without reading the archived files
+class VolIndexReader
+{
+public:
+	// Throws if the archive is malformed
+	static std::vector<ArchiveEntry> ReadEntries(const std::string& volFilename);
+
+	// Checks the data block header preceding an entry's data, and that the data lies within the archive
+	static bool IsValidDataBlock(const char* archiveData, std::size_t archiveSize, const ArchiveEntry& archiveEntry);
+
+private:
+	struct SectionHeader
+	{
+		uint32_t length;
+		uint64_t endPosition;
+	};
+
+	static const uint16_t UncompressedType;
+	static const std::size_t IndexEntrySize;
+	static const std::size_t SectionHeaderSize;
+
+	static SectionHeader ReadSectionHeader(std::ifstream& archive, uint64_t archiveSize, const char* expectedTag);
+	static uint32_t ReadUint32(const char* bytes);
+	static uint16_t ReadUint16(const char* bytes);
+};
@@ -0,0 +1,103 @@
+#include "../src/ArchiveIndexFile.h"
+#include "TemporaryDirectory.h"
+#include <gtest/gtest.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	void WriteFile(const std::string& filename, const std::string& contents)
+	{
+		std::ofstream file(filename, std::ios::out | std::ios::trunc);
+		file << contents;
+	}
+
+	std::string ReadFile(const std::string& filename)
+	{
+		std::ifstream file(filename);
+		return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	void ExpectEntriesEqual(const std::vector<ArchiveEntry>& expected, const std::vector<ArchiveEntry>& actual)
+	{
+		ASSERT_EQ(expected.size(), actual.size());
+		for (std::size_t i = 0; i < expected.size(); ++i) {
+			EXPECT_EQ(expected[i].filename, actual[i].filename);
+			EXPECT_EQ(expected[i].offset, actual[i].offset);
+			EXPECT_EQ(expected[i].size, actual[i].size);
+			EXPECT_EQ(expected[i].compressed, actual[i].compressed);
+		}
+	}
+
+	const std::vector<ArchiveEntry> TestEntries = {
+		{ "well0000.bmp", 1024, 36000, false },
+		{ "file with spaces.map", 5000000000ull, 0, true },
+	};
+}
+
+TEST(ArchiveIndexFile, SavesAndLoadsArchives)
+{
+	TemporaryDirectory directory;
+	const std::string indexFilename = directory.FilePath("archives.idx");
+
+	{
+		ArchiveIndexFile archiveIndexFile(indexFilename);
+		archiveIndexFile.Update("C:/Outpost 2/maps.vol", -1234567890123ll, 1 << 20, TestEntries);
+		archiveIndexFile.Update("empty.vol", 1, 0, {});
+		archiveIndexFile.Save();
+	}
+
+	ArchiveIndexFile archiveIndexFile(indexFilename);
+	std::vector<ArchiveEntry> archiveEntries;
+
+	ASSERT_TRUE(archiveIndexFile.Find("C:/Outpost 2/maps.vol", -1234567890123ll, 1 << 20, archiveEntries));
+	ExpectEntriesEqual(TestEntries, archiveEntries);
+
+	ASSERT_TRUE(archiveIndexFile.Find("empty.vol", 1, 0, archiveEntries));
+	EXPECT_TRUE(archiveEntries.empty());
+
+	// A changed modification time or size means the archive must be parsed again
+	EXPECT_FALSE(archiveIndexFile.Find("C:/Outpost 2/maps.vol", 0, 1 << 20, archiveEntries));
+	EXPECT_FALSE(archiveIndexFile.Find("C:/Outpost 2/maps.vol", -1234567890123ll, 1, archiveEntries));
+	EXPECT_FALSE(archiveIndexFile.Find("other.vol", 1, 0, archiveEntries));
+}
+
+TEST(ArchiveIndexFile, DiscardsDamagedIndexFiles)
+{
+	TemporaryDirectory directory;
+	const std::string indexFilename = directory.FilePath("archives.idx");
+
+	{
+		ArchiveIndexFile archiveIndexFile(indexFilename);
+		archiveIndexFile.Update("maps.vol", 5, 100, TestEntries);
+		archiveIndexFile.Save();
+	}
+
+	const std::string index = ReadFile(indexFilename);
+	const std::size_t archiveRecordOffset = index.find("\nA\t") + 1;
+	const std::size_t entryRecordOffset = index.find("\nE\t") + 1;
+	const std::string header = index.substr(0, archiveRecordOffset);
+
+	const std::vector<std::string> damagedIndexFiles = {
+		"",
+		"OP2MapImager Archive Index 0\n" + index.substr(archiveRecordOffset),
+		index.substr(0, entryRecordOffset), // Missing entry records
+		header + "A\t5\t100\n", // Missing fields
+		header + "A\tfive\t100\t2\tmaps.vol\n" + index.substr(entryRecordOffset),
+		header + "A\t5\t100\t99999999999\tmaps.vol\n" + index.substr(entryRecordOffset),
+		index.substr(0, entryRecordOffset) + "E\t1024\tbig\t0\twell0000.bmp\n",
+		index.substr(0, entryRecordOffset) + "X\t1024\t36000\t0\twell0000.bmp\n",
+		index + "garbage\n",
+	};
+
+	for (const auto& damagedIndexFile : damagedIndexFiles)
+	{
+		SCOPED_TRACE(damagedIndexFile);
+		WriteFile(indexFilename, damagedIndexFile);
+
+		ArchiveIndexFile archiveIndexFile(indexFilename);
+		std::vector<ArchiveEntry> archiveEntries;
+		EXPECT_FALSE(archiveIndexFile.Find("maps.vol", 5, 100, archiveEntries));
+	}
+}
@@ -0,0 +1,312 @@
+#include "../src/PngWriter.h"
+#include "../src/ThreadPool.h"
+#include "TestImage.h"
+#include <gtest/gtest.h>
+#include <zlib.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <array>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace
+{
+	// PNG decoded independently of PngWriter, using zlib to inflate the image data
+	struct DecodedPng
+	{
+		unsigned width = 0;
+		unsigned height = 0;
+		unsigned colorType = 0;
+		std::vector<std::array<BYTE, 3>> palette;
+		std::vector<BYTE> pixels; // Unfiltered rows of RGB, RGBA or palette indices
+		unsigned idatCount = 0;
+	};
+
+	uint32_t ReadUint32BigEndian(const BYTE* bytes)
+	{
+		return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) |
+			(static_cast<uint32_t>(bytes[2]) << 8) | bytes[3];
+	}
+
+	int PaethPredictor(int left, int above, int upperLeft)
+	{
+		const int estimate = left + above - upperLeft;
+		const int leftDistance = std::abs(estimate - left);
+		const int aboveDistance = std::abs(estimate - above);
+		const int upperLeftDistance = std::abs(estimate - upperLeft);
+
+		if (leftDistance <= aboveDistance && leftDistance <= upperLeftDistance) {
+			return left;
+		}
+		return aboveDistance <= upperLeftDistance ? above : upperLeft;
+	}
+
+	DecodedPng DecodePng(const std::string& file)
+	{
+		const BYTE* data = reinterpret_cast<const BYTE*>(file.data());
+		const BYTE signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+		if (file.size() < sizeof(signature) || std::memcmp(data, signature, sizeof(signature)) != 0) {
+			throw std::runtime_error("Missing PNG signature");
+		}
+
+		DecodedPng png;
+		std::vector<BYTE> compressedData;
+		bool endFound = false;
+
+		for (std::size_t offset = sizeof(signature); offset < file.size();)
+		{
+			if (endFound || file.size() - offset < 12) {
+				throw std::runtime_error("Data after IEND or truncated chunk");
+			}
+
+			const uint32_t length = ReadUint32BigEndian(data + offset);
+			if (length > file.size() - offset - 12) {
+				throw std::runtime_error("Truncated chunk");
+			}
+
+			const std::string type(reinterpret_cast<const char*>(data + offset + 4), 4);
+			const BYTE* chunkData = data + offset + 8;
+			const uint32_t crc = ReadUint32BigEndian(chunkData + length);
+
+			if (crc != crc32(crc32(0L, Z_NULL, 0), data + offset + 4, length + 4)) {
+				throw std::runtime_error("CRC mismatch in " + type);
+			}
+
+			if (type == "IHDR") {
+				png.width = ReadUint32BigEndian(chunkData);
+				png.height = ReadUint32BigEndian(chunkData + 4);
+				if (chunkData[8] != 8 || chunkData[10] != 0 || chunkData[11] != 0 || chunkData[12] != 0) {
+					throw std::runtime_error("Unexpected IHDR fields");
+				}
+				png.colorType = chunkData[9];
+			}
+			else if (type == "PLTE") {
+				for (uint32_t i = 0; i + 3 <= length; i += 3) {
+					png.palette.push_back({ chunkData[i], chunkData[i + 1], chunkData[i + 2] });
+				}
+			}
+			else if (type == "IDAT") {
+				compressedData.insert(compressedData.end(), chunkData, chunkData + length);
+				++png.idatCount;
+			}
+			else if (type == "IEND") {
+				endFound = true;
+			}
+
+			offset += 12 + length;
+		}
+
+		if (!endFound) {
+			throw std::runtime_error("Missing IEND");
+		}
+
+		const unsigned bytesPerPixel = png.colorType == 6 ? 4 : png.colorType == 2 ? 3 : 1;
+		const std::size_t rowByteCount = static_cast<std::size_t>(png.width) * bytesPerPixel;
+		std::vector<BYTE> filteredData(png.height * (rowByteCount + 1));
+
+		// Inflating into a buffer of exactly the expected size also verifies the adler32 checksum
+		uLongf filteredSize = static_cast<uLongf>(filteredData.size());
+		if (uncompress(filteredData.data(), &filteredSize, compressedData.data(), static_cast<uLong>(compressedData.size())) != Z_OK ||
+			filteredSize != filteredData.size())
+		{
+			throw std::runtime_error("Invalid zlib stream");
+		}
+
+		png.pixels.resize(png.height * rowByteCount);
+		for (unsigned y = 0; y < png.height; ++y)
+		{
+			const BYTE filterType = filteredData[y * (rowByteCount + 1)];
+			const BYTE* filtered = &filteredData[y * (rowByteCount + 1) + 1];
+			BYTE* row = &png.pixels[y * rowByteCount];
+			const BYTE* previousRow = y > 0 ? row - rowByteCount : nullptr;
+
+			for (std::size_t i = 0; i < rowByteCount; ++i)
+			{
+				const int left = i >= bytesPerPixel ? row[i - bytesPerPixel] : 0;
+				const int above = previousRow ? previousRow[i] : 0;
+				const int upperLeft = previousRow && i >= bytesPerPixel ? previousRow[i - bytesPerPixel] : 0;
+
+				int predictor;
+				switch (filterType)
+				{
+				case 0: predictor = 0; break;
+				case 1: predictor = left; break;
+				case 2: predictor = above; break;
+				case 3: predictor = (left + above) / 2; break;
+				case 4: predictor = PaethPredictor(left, above, upperLeft); break;
+				default: throw std::runtime_error("Invalid filter type");
+				}
+
+				row[i] = static_cast<BYTE>(filtered[i] + predictor);
+			}
+		}
+
+		return png;
+	}
+
+	std::string EncodePng(const TestImage& image, PngWriter::Filter filter = PngWriter::Filter::Adaptive,
+		int compressionLevel = Z_DEFAULT_COMPRESSION, int strategy = Z_DEFAULT_STRATEGY, ThreadPool* threadPool = nullptr)
+	{
+		std::ostringstream output;
+		PngWriter pngWriter(output, image.width, image.height, image.bytesPerPixel * 8, image.palette,
+			compressionLevel, filter, strategy, threadPool);
+		pngWriter.WriteScanlines(image.Scanline(0), image.Pitch(), image.height);
+		pngWriter.Finish();
+
+		return output.str();
+	}
+
+	void ExpectPixelsMatch(const TestImage& image, const DecodedPng& png)
+	{
+		ASSERT_EQ(image.width, png.width);
+		ASSERT_EQ(image.height, png.height);
+		ASSERT_EQ(image.bytesPerPixel == 4 ? 6u : image.bytesPerPixel == 3 ? 2u : 3u, png.colorType);
+
+		const unsigned bytesPerPixel = image.bytesPerPixel;
+		for (unsigned y = 0; y < image.height; ++y)
+		{
+			for (unsigned x = 0; x < image.width; ++x)
+			{
+				const BYTE* pixel = &png.pixels[(static_cast<std::size_t>(y) * image.width + x) * bytesPerPixel];
+				std::array<BYTE, 4> rgba;
+
+				if (bytesPerPixel == 1) {
+					ASSERT_LT(*pixel, png.palette.size());
+					ASSERT_EQ(image.Scanline(y)[x], *pixel);
+					rgba = { png.palette[*pixel][0], png.palette[*pixel][1], png.palette[*pixel][2], 255 };
+				}
+				else {
+					rgba = { pixel[0], pixel[1], pixel[2], static_cast<BYTE>(bytesPerPixel == 4 ? pixel[3] : 255) };
+				}
+
+				ASSERT_EQ(image.Rgba(x, y), rgba) << "at " << x << ", " << y;
+			}
+		}
+	}
+}
+
+TEST(PngWriter, RoundTripsEachPixelFormatAndFilter)
+{
+	const PngWriter::Filter filters[] = { PngWriter::Filter::None, PngWriter::Filter::Sub, PngWriter::Filter::Up,
+		PngWriter::Filter::Average, PngWriter::Filter::Paeth, PngWriter::Filter::Adaptive };
+
+	for (const unsigned bpp : { 8u, 24u, 32u }) {
+		const TestImage image(67, 130, bpp);
+
+		for (const auto filter : filters) {
+			SCOPED_TRACE("bpp " + std::to_string(bpp) + ", filter " + std::to_string(static_cast<int>(filter)));
+			ExpectPixelsMatch(image, DecodePng(EncodePng(image, filter)));
+		}
+	}
+}
+
+TEST(PngWriter, RoundTripsEachPreset)
+{
+	const TestImage image(150, 100, 24);
+
+	for (const auto preset : { PngPreset::Fast, PngPreset::Balanced, PngPreset::Small }) {
+		const auto compression = PngWriter::GetPresetCompression(preset);
+		ExpectPixelsMatch(image, DecodePng(EncodePng(image, compression.filter, compression.compressionLevel, compression.strategy)));
+	}
+}
+
+// 700 pixel rows of 24 bit pixels hold 124 rows per chunk, so the image spans several chunks
+TEST(PngWriter, OutputIsIdenticalForAnyThreadCount)
+{
+	const TestImage image(700, 450, 24);
+	const std::string singleThreadPng = EncodePng(image);
+
+	const DecodedPng png = DecodePng(singleThreadPng);
+	EXPECT_GT(png.idatCount, 1u);
+	ExpectPixelsMatch(image, png);
+
+	for (const std::size_t threadCount : { 1, 4, 16 }) {
+		ThreadPool threadPool(threadCount);
+		EXPECT_EQ(singleThreadPng, EncodePng(image, PngWriter::Filter::Adaptive, Z_DEFAULT_COMPRESSION, Z_DEFAULT_STRATEGY, &threadPool))
+			<< threadCount << " threads";
+	}
+}
+
+// More rows than are compressed in one batch of chunks
+TEST(PngWriter, RoundTripsImagesSpanningSeveralBatches)
+{
+	const TestImage image(256, 16600, 32);
+	const std::string singleThreadPng = EncodePng(image, PngWriter::Filter::Sub, 1);
+
+	ExpectPixelsMatch(image, DecodePng(singleThreadPng));
+
+	ThreadPool threadPool(4);
+	EXPECT_EQ(singleThreadPng, EncodePng(image, PngWriter::Filter::Sub, 1, Z_DEFAULT_STRATEGY, &threadPool));
+}
+
+TEST(PngWriter, ScanlineBlocksAndBottomUpPitchMatchSingleWrite)
+{
+	const TestImage image(300, 900, 24);
+	const std::string expectedPng = EncodePng(image);
+
+	// Store the image bottom-up as FreeImage does, then walk it with a negative pitch
+	std::vector<BYTE> bottomUpPixels(image.pixels.size());
+	for (unsigned y = 0; y < image.height; ++y) {
+		std::memcpy(&bottomUpPixels[(image.height - 1 - y) * image.Pitch()], image.Scanline(y), image.Pitch());
+	}
+
+	std::ostringstream output;
+	PngWriter pngWriter(output, image.width, image.height, 24);
+	const std::ptrdiff_t pitch = -static_cast<std::ptrdiff_t>(image.Pitch());
+
+	unsigned y = 0;
+	for (const unsigned blockHeight : { 1u, 7u, 250u, 0u, 642u }) {
+		pngWriter.WriteScanlines(&bottomUpPixels[(image.height - 1 - y) * image.Pitch()], pitch, blockHeight);
+		y += blockHeight;
+	}
+	ASSERT_EQ(image.height, y);
+	pngWriter.Finish();
+
+	EXPECT_EQ(expectedPng, output.str());
+}
+
+TEST(PngWriter, RejectsInvalidUse)
+{
+	std::ostringstream output;
+
+	EXPECT_THROW(PngWriter(output, 8, 8, 16), std::runtime_error);
+	EXPECT_THROW(PngWriter(output, 8, 8, 8), std::runtime_error); // Missing palette
+	EXPECT_THROW(PngWriter(output, 8, 8, 8, std::vector<RGBQUAD>(257)), std::runtime_error);
+	EXPECT_THROW(PngWriter(output, 8, 8, 24, {}, 10), std::runtime_error);
+
+	const TestImage image(8, 8, 24);
+
+	PngWriter incompleteWriter(output, 8, 8, 24);
+	incompleteWriter.WriteScanlines(image.Scanline(0), image.Pitch(), 4);
+	EXPECT_THROW(incompleteWriter.Finish(), std::runtime_error);
+	EXPECT_THROW(incompleteWriter.WriteScanlines(image.Scanline(0), image.Pitch(), 5), std::runtime_error);
+}
+
+TEST(PngWriter, DecodesWithFreeImage)
+{
+	for (const unsigned bpp : { 24u, 32u }) {
+		const TestImage image(97, 80, bpp);
+		std::string png = EncodePng(image);
+
+		FIMEMORY* fiMemory = FreeImage_OpenMemory(reinterpret_cast<BYTE*>(&png[0]), static_cast<DWORD>(png.size()));
+		FIBITMAP* bitmap = FreeImage_LoadFromMemory(FIF_PNG, fiMemory);
+		FreeImage_CloseMemory(fiMemory);
+		ASSERT_NE(nullptr, bitmap);
+
+		EXPECT_EQ(image.width, FreeImage_GetWidth(bitmap));
+		EXPECT_EQ(image.height, FreeImage_GetHeight(bitmap));
+		ASSERT_EQ(bpp, FreeImage_GetBPP(bitmap));
+
+		// FreeImage stores scanlines bottom-up in the same byte order as the source image
+		for (unsigned y = 0; y < image.height; ++y) {
+			EXPECT_EQ(0, std::memcmp(image.Scanline(y), FreeImage_GetScanLine(bitmap, image.height - 1 - y), image.Pitch()))
+				<< "bpp " << bpp << ", row " << y;
+		}
+
+		FreeImage_Unload(bitmap);
+	}
+}
@@ -0,0 +1,78 @@
+#include "../src/PnmWriter.h"
+#include "TestImage.h"
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <stdexcept>
+
+namespace
+{
+	std::string EncodePnm(const TestImage& image, PnmWriter::Format format)
+	{
+		std::ostringstream output;
+		PnmWriter pnmWriter(output, format, image.width, image.height, image.bytesPerPixel * 8, image.palette);
+		pnmWriter.WriteScanlines(image.Scanline(0), image.Pitch(), image.height / 2);
+		pnmWriter.WriteScanlines(image.Scanline(image.height / 2), image.Pitch(), image.height - image.height / 2);
+		pnmWriter.Finish();
+
+		return output.str();
+	}
+
+	void ExpectPixelsMatch(const TestImage& image, const std::string& pixels, unsigned channelCount)
+	{
+		ASSERT_EQ(static_cast<std::size_t>(image.width) * image.height * channelCount, pixels.size());
+
+		for (unsigned y = 0; y < image.height; ++y) {
+			for (unsigned x = 0; x < image.width; ++x) {
+				const auto rgba = image.Rgba(x, y);
+				const std::size_t offset = (static_cast<std::size_t>(y) * image.width + x) * channelCount;
+
+				for (unsigned channel = 0; channel < channelCount; ++channel) {
+					ASSERT_EQ(rgba[channel], static_cast<BYTE>(pixels[offset + channel])) << "at " << x << ", " << y;
+				}
+			}
+		}
+	}
+}
+
+TEST(PnmWriter, WritesPpm)
+{
+	for (const unsigned bpp : { 8u, 24u, 32u }) {
+		SCOPED_TRACE("bpp " + std::to_string(bpp));
+		const TestImage image(45, 31, bpp);
+		const std::string file = EncodePnm(image, PnmWriter::Format::PPM);
+
+		const std::string header = "P6\n45 31\n255\n";
+		ASSERT_EQ(header, file.substr(0, header.size()));
+		ExpectPixelsMatch(image, file.substr(header.size()), 3);
+	}
+}
+
+TEST(PnmWriter, WritesPam)
+{
+	for (const unsigned bpp : { 8u, 24u, 32u }) {
+		SCOPED_TRACE("bpp " + std::to_string(bpp));
+		const TestImage image(45, 31, bpp);
+		const std::string file = EncodePnm(image, PnmWriter::Format::PAM);
+
+		const unsigned channelCount = bpp == 32 ? 4 : 3;
+		const std::string header = "P7\nWIDTH 45\nHEIGHT 31\nDEPTH " + std::to_string(channelCount) +
+			"\nMAXVAL 255\nTUPLTYPE " + (bpp == 32 ? "RGB_ALPHA" : "RGB") + "\nENDHDR\n";
+		ASSERT_EQ(header, file.substr(0, header.size()));
+		ExpectPixelsMatch(image, file.substr(header.size()), channelCount);
+	}
+}
+
+TEST(PnmWriter, RejectsInvalidUse)
+{
+	std::ostringstream output;
+
+	EXPECT_THROW(PnmWriter(output, PnmWriter::Format::PPM, 8, 8, 16), std::runtime_error);
+	EXPECT_THROW(PnmWriter(output, PnmWriter::Format::PAM, 8, 8, 8), std::runtime_error); // Missing palette
+
+	const TestImage image(8, 8, 24);
+	PnmWriter pnmWriter(output, PnmWriter::Format::PPM, 8, 8, 24);
+	pnmWriter.WriteScanlines(image.Scanline(0), image.Pitch(), 3);
+	EXPECT_THROW(pnmWriter.Finish(), std::runtime_error);
+	EXPECT_THROW(pnmWriter.WriteScanlines(image.Scanline(0), image.Pitch(), 6), std::runtime_error);
+}
@@ -0,0 +1,161 @@
+#include "../src/QoiWriter.h"
+#include "TestImage.h"
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+
+namespace
+{
+	struct DecodedQoi
+	{
+		unsigned width = 0;
+		unsigned height = 0;
+		unsigned channels = 0;
+		std::vector<std::array<BYTE, 4>> pixels;
+	};
+
+	// Decoder following the QOI specification, independent of QoiWriter
+	DecodedQoi DecodeQoi(const std::string& file)
+	{
+		const BYTE* data = reinterpret_cast<const BYTE*>(file.data());
+		const BYTE endMarker[] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+
+		if (file.size() < 14 + sizeof(endMarker) || file.compare(0, 4, "qoif") != 0) {
+			throw std::runtime_error("Missing QOI header");
+		}
+
+		auto readUint32 = [&](std::size_t offset) {
+			return (static_cast<uint32_t>(data[offset]) << 24) | (static_cast<uint32_t>(data[offset + 1]) << 16) |
+				(static_cast<uint32_t>(data[offset + 2]) << 8) | data[offset + 3];
+		};
+
+		DecodedQoi qoi;
+		qoi.width = readUint32(4);
+		qoi.height = readUint32(8);
+		qoi.channels = data[12];
+
+		std::array<std::array<BYTE, 4>, 64> seenPixels{};
+		std::array<BYTE, 4> pixel = { 0, 0, 0, 255 };
+		const std::size_t pixelCount = static_cast<std::size_t>(qoi.width) * qoi.height;
+		const std::size_t dataEnd = file.size() - sizeof(endMarker);
+		std::size_t offset = 14;
+
+		while (qoi.pixels.size() < pixelCount)
+		{
+			if (offset >= dataEnd) {
+				throw std::runtime_error("Truncated QOI data");
+			}
+
+			const BYTE tag = data[offset++];
+			unsigned runLength = 1;
+
+			if (tag == 0xFE) {
+				pixel = { data[offset], data[offset + 1], data[offset + 2], pixel[3] };
+				offset += 3;
+			}
+			else if (tag == 0xFF) {
+				pixel = { data[offset], data[offset + 1], data[offset + 2], data[offset + 3] };
+				offset += 4;
+			}
+			else if ((tag & 0xC0) == 0x00) {
+				pixel = seenPixels[tag];
+			}
+			else if ((tag & 0xC0) == 0x40) {
+				pixel[0] = static_cast<BYTE>(pixel[0] + ((tag >> 4) & 3) - 2);
+				pixel[1] = static_cast<BYTE>(pixel[1] + ((tag >> 2) & 3) - 2);
+				pixel[2] = static_cast<BYTE>(pixel[2] + (tag & 3) - 2);
+			}
+			else if ((tag & 0xC0) == 0x80) {
+				const int greenDifference = (tag & 0x3F) - 32;
+				const BYTE next = data[offset++];
+				pixel[0] = static_cast<BYTE>(pixel[0] + greenDifference + ((next >> 4) & 0xF) - 8);
+				pixel[1] = static_cast<BYTE>(pixel[1] + greenDifference);
+				pixel[2] = static_cast<BYTE>(pixel[2] + greenDifference + (next & 0xF) - 8);
+			}
+			else {
+				runLength = (tag & 0x3F) + 1;
+			}
+
+			seenPixels[(pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64] = pixel;
+
+			for (unsigned i = 0; i < runLength; ++i) {
+				qoi.pixels.push_back(pixel);
+			}
+		}
+
+		if (qoi.pixels.size() != pixelCount || offset != dataEnd || file.compare(dataEnd, sizeof(endMarker),
+			std::string(reinterpret_cast<const char*>(endMarker), sizeof(endMarker))) != 0)
+		{
+			throw std::runtime_error("Invalid QOI data end");
+		}
+
+		return qoi;
+	}
+
+	void ExpectPixelsMatch(const TestImage& image, const DecodedQoi& qoi)
+	{
+		ASSERT_EQ(image.width, qoi.width);
+		ASSERT_EQ(image.height, qoi.height);
+		ASSERT_EQ(image.bytesPerPixel == 4 ? 4u : 3u, qoi.channels);
+
+		for (unsigned y = 0; y < image.height; ++y) {
+			for (unsigned x = 0; x < image.width; ++x) {
+				ASSERT_EQ(image.Rgba(x, y), qoi.pixels[static_cast<std::size_t>(y) * image.width + x]) << "at " << x << ", " << y;
+			}
+		}
+	}
+}
+
+TEST(QoiWriter, RoundTripsEachPixelFormat)
+{
+	for (const unsigned bpp : { 8u, 24u, 32u }) {
+		SCOPED_TRACE("bpp " + std::to_string(bpp));
+		const TestImage image(333, 200, bpp);
+
+		// Blocks of scanlines must continue runs and the pixel index across calls
+		std::ostringstream output;
+		QoiWriter qoiWriter(output, image.width, image.height, bpp, image.palette);
+		qoiWriter.WriteScanlines(image.Scanline(0), image.Pitch(), 1);
+		qoiWriter.WriteScanlines(image.Scanline(1), image.Pitch(), 120);
+		qoiWriter.WriteScanlines(image.Scanline(121), image.Pitch(), 79);
+		qoiWriter.Finish();
+
+		ExpectPixelsMatch(image, DecodeQoi(output.str()));
+	}
+}
+
+// Runs are limited to 62 pixels, so a long row of one color splits into several runs
+TEST(QoiWriter, EncodesLongRuns)
+{
+	const unsigned width = 1000;
+	std::vector<BYTE> row(width * 3, 0x40);
+
+	std::ostringstream output;
+	QoiWriter qoiWriter(output, width, 2, 24);
+	qoiWriter.WriteScanlines(row.data(), 0, 2);
+	qoiWriter.Finish();
+
+	const DecodedQoi qoi = DecodeQoi(output.str());
+	ASSERT_EQ(2u * width, qoi.pixels.size());
+	for (const auto& pixel : qoi.pixels) {
+		EXPECT_EQ((std::array<BYTE, 4>{ 0x40, 0x40, 0x40, 255 }), pixel);
+	}
+}
+
+TEST(QoiWriter, RejectsInvalidUse)
+{
+	std::ostringstream output;
+
+	EXPECT_THROW(QoiWriter(output, 8, 8, 16), std::runtime_error);
+	EXPECT_THROW(QoiWriter(output, 8, 8, 8), std::runtime_error); // Missing palette
+
+	const TestImage image(8, 8, 24);
+	QoiWriter qoiWriter(output, 8, 8, 24);
+	qoiWriter.WriteScanlines(image.Scanline(0), image.Pitch(), 7);
+	EXPECT_THROW(qoiWriter.Finish(), std::runtime_error);
+	EXPECT_THROW(qoiWriter.WriteScanlines(image.Scanline(0), image.Pitch(), 2), std::runtime_error);
+}
@@ -0,0 +1,99 @@
+#include "../src/RenderManifest.h"
+#include "TemporaryDirectory.h"
+#include <gtest/gtest.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	void WriteFile(const std::string& filename, const std::string& contents)
+	{
+		std::ofstream file(filename, std::ios::out | std::ios::trunc);
+		file << contents;
+	}
+
+	std::string ReadFile(const std::string& filename)
+	{
+		std::ifstream file(filename);
+		return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+}
+
+TEST(RenderManifest, SavesAndLoadsRecords)
+{
+	TemporaryDirectory directory;
+	const std::string manifestFilename = directory.FilePath("manifest.txt");
+	const std::vector<std::string> renderFilenames = { directory.FilePath("Eden01.png"), directory.FilePath("Eden01 (2).png") };
+	for (const auto& renderFilename : renderFilenames) {
+		WriteFile(renderFilename, "render");
+	}
+
+	{
+		RenderManifest renderManifest(manifestFilename);
+		renderManifest.Update("maps/Eden01.map|s4", 0x0123456789abcdefull, renderFilenames);
+		renderManifest.Update("maps/Lava.map\tkey with tab", 42, { directory.FilePath("missing.png") });
+		renderManifest.Save();
+	}
+
+	RenderManifest renderManifest(manifestFilename);
+	std::vector<std::string> loadedFilenames;
+
+	EXPECT_TRUE(renderManifest.IsUpToDate("maps/Eden01.map|s4", 0x0123456789abcdefull, loadedFilenames));
+	EXPECT_EQ(renderFilenames, loadedFilenames);
+
+	// Changed inputs, missing renders and unknown jobs render again
+	EXPECT_FALSE(renderManifest.IsUpToDate("maps/Eden01.map|s4", 1, loadedFilenames));
+	EXPECT_FALSE(renderManifest.IsUpToDate("maps/Lava.map\tkey with tab", 42, loadedFilenames));
+	EXPECT_FALSE(renderManifest.IsUpToDate("maps/Other.map", 42, loadedFilenames));
+}
+
+TEST(RenderManifest, SaveWithoutChangesKeepsFile)
+{
+	TemporaryDirectory directory;
+	const std::string manifestFilename = directory.FilePath("manifest.txt");
+
+	RenderManifest renderManifest(manifestFilename);
+	renderManifest.Save();
+	EXPECT_FALSE(std::ifstream(manifestFilename).good());
+}
+
+TEST(RenderManifest, DiscardsDamagedManifests)
+{
+	TemporaryDirectory directory;
+	const std::string manifestFilename = directory.FilePath("manifest.txt");
+	const std::string renderFilename = directory.FilePath("render.png");
+	WriteFile(renderFilename, "render");
+
+	{
+		RenderManifest renderManifest(manifestFilename);
+		renderManifest.Update("job", 7, { renderFilename });
+		renderManifest.Save();
+	}
+
+	const std::string manifest = ReadFile(manifestFilename);
+	const std::size_t jobRecordOffset = manifest.find("\nJ\t") + 1;
+	ASSERT_NE(std::string::npos, manifest.find("\nR\t"));
+
+	const std::vector<std::string> damagedManifests = {
+		"",
+		"Some other file\n" + manifest.substr(jobRecordOffset),
+		manifest.substr(0, manifest.find("\nR\t") + 1), // Missing render record
+		manifest.substr(0, jobRecordOffset) + "J\t0000000000000007\n", // Missing fields
+		manifest.substr(0, jobRecordOffset) + "J\t00000000000000zz\t1\tjob\n" + manifest.substr(manifest.find("\nR\t") + 1),
+		manifest.substr(0, jobRecordOffset) + "J\t0000000000000007\tmany\tjob\n",
+		manifest.substr(0, jobRecordOffset) + "J\t0000000000000007\t99999999999\tjob\n" + manifest.substr(manifest.find("\nR\t") + 1),
+		manifest.substr(0, jobRecordOffset) + "X\t0000000000000007\t1\tjob\n" + manifest.substr(manifest.find("\nR\t") + 1),
+		manifest + "garbage\n",
+	};
+
+	for (const auto& damagedManifest : damagedManifests)
+	{
+		SCOPED_TRACE(damagedManifest);
+		WriteFile(manifestFilename, damagedManifest);
+
+		RenderManifest renderManifest(manifestFilename);
+		std::vector<std::string> renderFilenames;
+		EXPECT_FALSE(renderManifest.IsUpToDate("job", 7, renderFilenames));
+	}
+}
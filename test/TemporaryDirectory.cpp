@@ -0,0 +1,21 @@
+#include "TemporaryDirectory.h"
+#include <filesystem>
+#include <random>
+
+TemporaryDirectory::TemporaryDirectory()
+{
+	std::random_device randomDevice;
+	path = (std::filesystem::temp_directory_path() / ("OP2MapImagerTest." + std::to_string(randomDevice()))).string();
+	std::filesystem::create_directories(path);
+}
+
+TemporaryDirectory::~TemporaryDirectory()
+{
+	std::error_code errorCode;
+	std::filesystem::remove_all(path, errorCode);
+}
+
+std::string TemporaryDirectory::FilePath(const std::string& filename) const
+{
+	return (std::filesystem::path(path) / filename).string();
+}
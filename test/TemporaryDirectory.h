@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+
+// Creates a uniquely named directory for a test's files, removed along with its contents on destruction
+class TemporaryDirectory
+{
+public:
+	TemporaryDirectory();
+	~TemporaryDirectory();
+
+	TemporaryDirectory(const TemporaryDirectory&) = delete;
+	TemporaryDirectory& operator=(const TemporaryDirectory&) = delete;
+
+	// Path of a file within the directory
+	std::string FilePath(const std::string& filename) const;
+
+private:
+	std::string path;
+};
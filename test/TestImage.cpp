@@ -0,0 +1,72 @@
+#include "TestImage.h"
+#include <cstdint>
+
+TestImage::TestImage(unsigned width, unsigned height, unsigned bpp) :
+	width(width),
+	height(height),
+	bytesPerPixel(bpp / 8),
+	pixels(static_cast<std::size_t>(width) * height * (bpp / 8))
+{
+	if (bytesPerPixel == 1) {
+		for (unsigned i = 0; i < 256; ++i) {
+			palette.push_back(RGBQUAD{ static_cast<BYTE>(i * 3), static_cast<BYTE>(255 - i), static_cast<BYTE>(i * 7), 0 });
+		}
+	}
+
+	uint32_t random = 12345;
+	for (unsigned y = 0; y < height; ++y)
+	{
+		for (unsigned x = 0; x < width; ++x)
+		{
+			BYTE* pixel = &pixels[(static_cast<std::size_t>(y) * width + x) * bytesPerPixel];
+			random = random * 1103515245 + 12345;
+
+			for (unsigned channel = 0; channel < bytesPerPixel; ++channel)
+			{
+				BYTE value;
+				if (y % 64 < 16) {
+					value = static_cast<BYTE>(x + y * channel); // Gradient
+				}
+				else if (y % 64 < 32) {
+					value = static_cast<BYTE>(random >> (8 + channel * 4)); // Noise
+				}
+				else if (y % 64 < 48) {
+					value = static_cast<BYTE>(x / 100 * 40 + channel); // Long runs of one color
+				}
+				else {
+					value = static_cast<BYTE>((x % 8) * 30 + (y % 4) * channel); // Repeated patch
+				}
+
+				// Vary alpha separately, so alpha changes are encoded
+				if (channel == 3) {
+					value = (x / 50) % 3 == 0 ? 255 : static_cast<BYTE>(value | 0x80);
+				}
+
+				pixel[channel] = value;
+			}
+		}
+	}
+}
+
+std::size_t TestImage::Pitch() const
+{
+	return static_cast<std::size_t>(width) * bytesPerPixel;
+}
+
+const BYTE* TestImage::Scanline(unsigned y) const
+{
+	return &pixels[y * Pitch()];
+}
+
+std::array<BYTE, 4> TestImage::Rgba(unsigned x, unsigned y) const
+{
+	const BYTE* pixel = Scanline(y) + static_cast<std::size_t>(x) * bytesPerPixel;
+
+	if (bytesPerPixel == 1) {
+		const RGBQUAD& color = palette[*pixel];
+		return { color.rgbRed, color.rgbGreen, color.rgbBlue, 255 };
+	}
+
+	return { pixel[FI_RGBA_RED], pixel[FI_RGBA_GREEN], pixel[FI_RGBA_BLUE],
+		static_cast<BYTE>(bytesPerPixel == 4 ? pixel[FI_RGBA_ALPHA] : 255) };
+}
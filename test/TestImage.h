@@ -0,0 +1,25 @@
+#pragma once
+
+#include "../FreeImage/Dist/x32/FreeImage.h"
+#include <vector>
+#include <array>
+#include <cstddef>
+
+// Synthetic image in FreeImage byte order (BGR, BGRA or palette indices), top row first without row padding.
+// Mixes gradients, noise, runs of one color and repeated patches, so every encoder path is exercised.
+struct TestImage
+{
+	unsigned width;
+	unsigned height;
+	unsigned bytesPerPixel;
+	std::vector<BYTE> pixels;
+	std::vector<RGBQUAD> palette; // Set for 8 bit images
+
+	TestImage(unsigned width, unsigned height, unsigned bpp);
+
+	std::size_t Pitch() const;
+	const BYTE* Scanline(unsigned y) const;
+
+	// Red, green, blue and alpha of a pixel, expanding palette indices. Alpha is 255 without an alpha channel.
+	std::array<BYTE, 4> Rgba(unsigned x, unsigned y) const;
+};
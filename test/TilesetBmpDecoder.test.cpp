@@ -0,0 +1,164 @@
+#include "../src/TilesetBmpDecoder.h"
+#include <gtest/gtest.h>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+
+namespace
+{
+	const unsigned TileLength = 32;
+
+	void WriteUint32(std::vector<BYTE>& buffer, std::size_t offset, uint32_t value)
+	{
+		for (unsigned i = 0; i < 4; ++i) {
+			buffer[offset + i] = static_cast<BYTE>(value >> (i * 8));
+		}
+	}
+
+	// An Outpost 2 tileset: an uncompressed, bottom-up, 8 bit bitmap 32 pixels wide
+	std::vector<BYTE> CreateTilesetBmp(unsigned tileCount, unsigned paletteCount = 256)
+	{
+		const std::size_t paletteEntryCount = paletteCount == 0 ? 256 : paletteCount;
+		const std::size_t pixelDataOffset = 14 + 40 + paletteEntryCount * sizeof(RGBQUAD);
+		const unsigned height = tileCount * TileLength;
+		std::vector<BYTE> bmp(pixelDataOffset + static_cast<std::size_t>(TileLength) * height);
+
+		bmp[0] = 'B';
+		bmp[1] = 'M';
+		WriteUint32(bmp, 2, static_cast<uint32_t>(bmp.size()));
+		WriteUint32(bmp, 10, static_cast<uint32_t>(pixelDataOffset));
+		WriteUint32(bmp, 14, 40);
+		WriteUint32(bmp, 18, TileLength);
+		WriteUint32(bmp, 22, height);
+		WriteUint32(bmp, 26, 1 | (8 << 16)); // Planes, bits per pixel
+		WriteUint32(bmp, 46, paletteCount);
+
+		for (std::size_t i = 0; i < paletteEntryCount; ++i) {
+			BYTE* color = &bmp[54 + i * sizeof(RGBQUAD)];
+			color[0] = static_cast<BYTE>(i * 5); // Blue
+			color[1] = static_cast<BYTE>(255 - i); // Green
+			color[2] = static_cast<BYTE>(i * 11); // Red
+		}
+
+		for (std::size_t i = pixelDataOffset; i < bmp.size(); ++i) {
+			bmp[i] = static_cast<BYTE>(i * 7 + i / 97);
+		}
+
+		return bmp;
+	}
+
+	void ExpectMatchesPalette(const std::vector<BYTE>& bmp, const FreeImageBmp& bitmap, unsigned paletteCount)
+	{
+		const std::size_t pixelDataOffset = 14 + 40 + (paletteCount == 0 ? 256 : paletteCount) * sizeof(RGBQUAD);
+		const unsigned bytesPerPixel = bitmap.Bpp() / 8;
+
+		for (unsigned y = 0; y < bitmap.Height(); ++y)
+		{
+			for (unsigned x = 0; x < TileLength; ++x)
+			{
+				const BYTE index = bmp[pixelDataOffset + y * TileLength + x];
+				const BYTE* pixel = bitmap.ScanLine(y) + x * bytesPerPixel;
+				const bool inPalette = paletteCount == 0 || index < paletteCount;
+				const BYTE* color = &bmp[54 + index * sizeof(RGBQUAD)];
+
+				ASSERT_EQ(inPalette ? color[2] : 0, pixel[FI_RGBA_RED]) << "at " << x << ", " << y;
+				ASSERT_EQ(inPalette ? color[1] : 0, pixel[FI_RGBA_GREEN]) << "at " << x << ", " << y;
+				ASSERT_EQ(inPalette ? color[0] : 0, pixel[FI_RGBA_BLUE]) << "at " << x << ", " << y;
+				if (bytesPerPixel == 4) {
+					ASSERT_EQ(0xFF, pixel[FI_RGBA_ALPHA]);
+				}
+			}
+		}
+	}
+}
+
+class TilesetBmpDecoderTest : public ::testing::Test
+{
+protected:
+	static void SetUpTestSuite()
+	{
+		FreeImage_Initialise();
+	}
+
+	static void TearDownTestSuite()
+	{
+		FreeImage_DeInitialise();
+	}
+};
+
+TEST_F(TilesetBmpDecoderTest, ExpandsPaletteIndices)
+{
+	for (const unsigned bpp : { 24u, 32u }) {
+		for (const unsigned paletteCount : { 0u, 256u, 16u }) {
+			SCOPED_TRACE("bpp " + std::to_string(bpp) + ", palette " + std::to_string(paletteCount));
+			const auto bmp = CreateTilesetBmp(5, paletteCount);
+
+			const auto bitmap = TilesetBmpDecoder::Decode(bmp.data(), bmp.size(), bpp);
+			ASSERT_NE(nullptr, bitmap);
+			EXPECT_EQ(TileLength, bitmap->Width());
+			EXPECT_EQ(5 * TileLength, bitmap->Height());
+			EXPECT_EQ(bpp, bitmap->Bpp());
+			ExpectMatchesPalette(bmp, *bitmap, paletteCount);
+		}
+	}
+}
+
+TEST_F(TilesetBmpDecoderTest, MatchesFreeImage)
+{
+	auto bmp = CreateTilesetBmp(8);
+
+	for (const unsigned bpp : { 24u, 32u }) {
+		SCOPED_TRACE("bpp " + std::to_string(bpp));
+		const auto bitmap = TilesetBmpDecoder::Decode(bmp.data(), bmp.size(), bpp);
+		ASSERT_NE(nullptr, bitmap);
+
+		FIMEMORY* fiMemory = FreeImage_OpenMemory(bmp.data(), static_cast<DWORD>(bmp.size()));
+		const FreeImageBmp freeImageBitmap = FreeImageBmp(FIF_BMP, fiMemory).ConvertToBpp(bpp);
+		FreeImage_CloseMemory(fiMemory);
+
+		ASSERT_EQ(freeImageBitmap.Width(), bitmap->Width());
+		ASSERT_EQ(freeImageBitmap.Height(), bitmap->Height());
+		for (unsigned y = 0; y < bitmap->Height(); ++y) {
+			ASSERT_EQ(0, std::memcmp(freeImageBitmap.ScanLine(y), bitmap->ScanLine(y), TileLength * bpp / 8)) << "row " << y;
+		}
+	}
+}
+
+// Layouts other than an Outpost 2 tileset are left to FreeImage
+TEST_F(TilesetBmpDecoderTest, ReturnsNullForOtherLayouts)
+{
+	const auto bmp = CreateTilesetBmp(2);
+	EXPECT_EQ(nullptr, TilesetBmpDecoder::Decode(bmp.data(), bmp.size(), 8));
+	EXPECT_EQ(nullptr, TilesetBmpDecoder::Decode(bmp.data(), 40, 24));
+
+	auto otherLayout = [&](std::size_t offset, uint32_t value) {
+		auto changedBmp = bmp;
+		WriteUint32(changedBmp, offset, value);
+		return TilesetBmpDecoder::Decode(changedBmp.data(), changedBmp.size(), 24);
+	};
+
+	EXPECT_EQ(nullptr, otherLayout(0, 'X' | ('M' << 8))); // Tag
+	EXPECT_EQ(nullptr, otherLayout(18, 64)); // Width
+	EXPECT_EQ(nullptr, otherLayout(22, static_cast<uint32_t>(-64))); // Top-down
+	EXPECT_EQ(nullptr, otherLayout(26, 1 | (24 << 16))); // 24 bit pixels
+	EXPECT_EQ(nullptr, otherLayout(30, 1)); // RLE compressed
+	EXPECT_EQ(nullptr, otherLayout(46, 257)); // Palette count
+}
+
+TEST_F(TilesetBmpDecoderTest, ThrowsForDamagedTilesets)
+{
+	const auto bmp = CreateTilesetBmp(2);
+
+	// Truncated pixels and palette
+	EXPECT_THROW(TilesetBmpDecoder::Decode(bmp.data(), bmp.size() - 1, 24), std::runtime_error);
+	EXPECT_THROW(TilesetBmpDecoder::Decode(bmp.data(), 14 + 40 + 100, 24), std::runtime_error);
+
+	auto damagedBmp = bmp;
+	WriteUint32(damagedBmp, 10, static_cast<uint32_t>(bmp.size() + 1)); // Pixel data offset
+	EXPECT_THROW(TilesetBmpDecoder::Decode(damagedBmp.data(), damagedBmp.size(), 24), std::runtime_error);
+
+	damagedBmp = bmp;
+	WriteUint32(damagedBmp, 22, TileLength + 1); // Height is not a whole number of tiles
+	EXPECT_THROW(TilesetBmpDecoder::Decode(damagedBmp.data(), damagedBmp.size(), 24), std::runtime_error);
+}
@@ -0,0 +1,175 @@
+#include "../src/VolIndexReader.h"
+#include "TemporaryDirectory.h"
+#include <gtest/gtest.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+
+namespace
+{
+	struct VolFile
+	{
+		std::string filename;
+		std::string data;
+		uint16_t compressionType;
+	};
+
+	void AppendUint32(std::string& buffer, uint32_t value)
+	{
+		for (int shift = 0; shift < 32; shift += 8) {
+			buffer.push_back(static_cast<char>(value >> shift));
+		}
+	}
+
+	void AppendSection(std::string& buffer, const char* tag, const std::string& contents)
+	{
+		buffer.append(tag, 4);
+		AppendUint32(buffer, static_cast<uint32_t>(contents.size()) | 0x80000000);
+		buffer += contents;
+	}
+
+	// Lays out a .vol archive as Outpost 2 does: header sections, then one VBLK data block per file
+	std::string CreateVol(const std::vector<VolFile>& files)
+	{
+		std::string stringTable;
+		std::vector<uint32_t> filenameOffsets;
+		for (const auto& file : files) {
+			filenameOffsets.push_back(static_cast<uint32_t>(stringTable.size()));
+			stringTable += file.filename + '\0';
+		}
+
+		std::string vols;
+		AppendUint32(vols, static_cast<uint32_t>(stringTable.size()));
+		vols += stringTable;
+		while (vols.size() % 4 != 0) {
+			vols.push_back('\0');
+		}
+
+		// The entry table is padded with an entry past the end of the string table
+		const std::size_t voliSize = (files.size() + 1) * 14;
+		std::size_t dataBlockOffset = 8 + 8 + 8 + vols.size() + 8 + voliSize;
+
+		std::string voli;
+		for (std::size_t i = 0; i < files.size(); ++i)
+		{
+			AppendUint32(voli, filenameOffsets[i]);
+			AppendUint32(voli, static_cast<uint32_t>(dataBlockOffset));
+			AppendUint32(voli, static_cast<uint32_t>(files[i].data.size()));
+			voli.push_back(static_cast<char>(files[i].compressionType));
+			voli.push_back(static_cast<char>(files[i].compressionType >> 8));
+
+			dataBlockOffset += 8 + files[i].data.size();
+		}
+		AppendUint32(voli, static_cast<uint32_t>(stringTable.size()));
+		voli.append(10, '\0');
+
+		std::string header;
+		AppendSection(header, "volh", "");
+		AppendSection(header, "vols", vols);
+		AppendSection(header, "voli", voli);
+
+		std::string archive;
+		AppendSection(archive, "VOL ", header);
+		for (const auto& file : files) {
+			AppendSection(archive, "VBLK", file.data);
+		}
+
+		return archive;
+	}
+
+	void WriteFile(const std::string& filename, const std::string& contents)
+	{
+		std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+		file << contents;
+	}
+
+	const std::vector<VolFile> TestFiles = {
+		{ "well0000.bmp", std::string(300, 'a'), 0x100 },
+		{ "Eden01.map", "map data", 0x103 },
+		{ "empty.txt", "", 0x100 },
+	};
+}
+
+TEST(VolIndexReader, ReadsEntries)
+{
+	TemporaryDirectory directory;
+	const std::string volFilename = directory.FilePath("test.vol");
+	const std::string archive = CreateVol(TestFiles);
+	WriteFile(volFilename, archive);
+
+	const auto archiveEntries = VolIndexReader::ReadEntries(volFilename);
+	ASSERT_EQ(TestFiles.size(), archiveEntries.size());
+
+	for (std::size_t i = 0; i < TestFiles.size(); ++i)
+	{
+		SCOPED_TRACE(TestFiles[i].filename);
+		EXPECT_EQ(TestFiles[i].filename, archiveEntries[i].filename);
+		EXPECT_EQ(TestFiles[i].data.size(), archiveEntries[i].size);
+		EXPECT_EQ(TestFiles[i].compressionType != 0x100, archiveEntries[i].compressed);
+		EXPECT_EQ(TestFiles[i].data, archive.substr(archiveEntries[i].offset, archiveEntries[i].size));
+		EXPECT_TRUE(VolIndexReader::IsValidDataBlock(archive.data(), archive.size(), archiveEntries[i]));
+	}
+}
+
+TEST(VolIndexReader, RejectsInvalidDataBlocks)
+{
+	const std::string archive = CreateVol(TestFiles);
+
+	// The second file's block follows the first file's block
+	const std::size_t firstBlockOffset = archive.find("VBLK");
+	const std::size_t secondDataOffset = firstBlockOffset + 8 + TestFiles[0].data.size() + 8;
+	const ArchiveEntry archiveEntry{ TestFiles[1].filename, secondDataOffset, TestFiles[1].data.size(), true };
+	ASSERT_TRUE(VolIndexReader::IsValidDataBlock(archive.data(), archive.size(), archiveEntry));
+
+	ArchiveEntry largerThanBlock = archiveEntry;
+	largerThanBlock.size = 9;
+	EXPECT_FALSE(VolIndexReader::IsValidDataBlock(archive.data(), archive.size(), largerThanBlock));
+
+	ArchiveEntry wrongTag = archiveEntry;
+	wrongTag.offset -= 1;
+	EXPECT_FALSE(VolIndexReader::IsValidDataBlock(archive.data(), archive.size(), wrongTag));
+
+	ArchiveEntry beforeArchive = archiveEntry;
+	beforeArchive.offset = 4;
+	EXPECT_FALSE(VolIndexReader::IsValidDataBlock(archive.data(), archive.size(), beforeArchive));
+
+	ArchiveEntry pastArchive = archiveEntry;
+	pastArchive.offset = archive.size() + 8;
+	EXPECT_FALSE(VolIndexReader::IsValidDataBlock(archive.data(), archive.size(), pastArchive));
+
+	EXPECT_FALSE(VolIndexReader::IsValidDataBlock(archive.data(), secondDataOffset + 4, archiveEntry));
+}
+
+TEST(VolIndexReader, RejectsDamagedArchives)
+{
+	TemporaryDirectory directory;
+	const std::string volFilename = directory.FilePath("damaged.vol");
+	const std::string archive = CreateVol(TestFiles);
+
+	EXPECT_THROW(VolIndexReader::ReadEntries(directory.FilePath("missing.vol")), std::runtime_error);
+
+	std::string wrongTag = archive;
+	wrongTag[0] = 'X';
+	WriteFile(volFilename, wrongTag);
+	EXPECT_THROW(VolIndexReader::ReadEntries(volFilename), std::runtime_error);
+
+	// Cut within the entry table
+	const std::size_t voliOffset = archive.find("voli");
+	WriteFile(volFilename, archive.substr(0, voliOffset + 8 + 10));
+	EXPECT_THROW(VolIndexReader::ReadEntries(volFilename), std::runtime_error);
+
+	// A string table longer than its section
+	const std::size_t volsOffset = archive.find("vols");
+	std::string longStringTable = archive;
+	longStringTable[volsOffset + 8 + 1] = 0x10;
+	WriteFile(volFilename, longStringTable);
+	EXPECT_THROW(VolIndexReader::ReadEntries(volFilename), std::runtime_error);
+
+	// A section length far beyond the end of the archive must not be allocated
+	std::string hugeSection = archive;
+	hugeSection.replace(voliOffset + 4, 4, "\xF0\xFF\xFF\x7F");
+	WriteFile(volFilename, hugeSection);
+	EXPECT_THROW(VolIndexReader::ReadEntries(volFilename), std::runtime_error);
+}